@@ -0,0 +1,88 @@
+#ifndef SPDNET_BENCH_BENCH_JSON_H_
+#define SPDNET_BENCH_BENCH_JSON_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+/*
+ * 基准测试结果的JSON输出 , 只覆盖用到的字符串、数字两种值 。
+ * 格式是一个对象 : 描述本次运行的字段 , 加上每项结果一行的results数组 , 便于逐个提交比较和用脚本处理 。
+**/
+
+inline std::string json_quote(const std::string &value) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// 一个JSON对象 , 值在add时就格式化成JSON字面量 , 字段保持添加顺序
+class json_record {
+public:
+    json_record &add_string(const char *key, const std::string &value) {
+        fields_.emplace_back(key, json_quote(value));
+        return *this;
+    }
+
+    json_record &add_number(const char *key, double value) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.3f", value);
+        fields_.emplace_back(key, buf);
+        return *this;
+    }
+
+    json_record &add_count(const char *key, uint64_t value) {
+        fields_.emplace_back(key, std::to_string(value));
+        return *this;
+    }
+
+    const std::vector<std::pair<std::string, std::string>> &fields() const {
+        return fields_;
+    }
+
+    std::string to_string() const {
+        std::string result = "{";
+        for (size_t i = 0; i < fields_.size(); i++) {
+            if (i > 0)
+                result += ", ";
+            result += json_quote(fields_[i].first) + ": " + fields_[i].second;
+        }
+        return result + "}";
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> fields_;
+};
+
+// 写出header的字段和results数组 , out为空时写到stdout
+inline bool write_json_report(const json_record &header, const std::vector<json_record> &results,
+                              const std::string &out) {
+    std::string json = "{\n";
+    for (const auto &field : header.fields())
+        json += "  " + json_quote(field.first) + ": " + field.second + ",\n";
+    json += "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+        json += "    " + results[i].to_string() + (i + 1 < results.size() ? ",\n" : "\n");
+    json += "  ]\n}\n";
+
+    if (out.empty()) {
+        fputs(json.c_str(), stdout);
+        return true;
+    }
+    FILE *file = fopen(out.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "open %s failed\n", out.c_str());
+        return false;
+    }
+    fputs(json.c_str(), file);
+    fclose(file);
+    return true;
+}
+
+#endif  // SPDNET_BENCH_BENCH_JSON_H_
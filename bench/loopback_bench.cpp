@@ -0,0 +1,648 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <spdnet/base/platform.h>
+#include <spdnet/base/stat_counter.h>
+#include <spdnet/net/event_service.h>
+#include <spdnet/net/acceptor.h>
+#include <spdnet/net/connector.h>
+#include <spdnet/net/http/http_server.h>
+#include "bench_json.h"
+
+#if defined(SPDNET_PLATFORM_LINUX)
+
+#include <sys/resource.h>
+
+#endif
+
+/*
+ * 回环地址上的端到端基准测试 , 服务端和客户端都用spdnet , 各自一个event_service 。
+ * 结果以JSON输出到stdout或--out指定的文件 , 便于逐个提交比较 ; 进度打印到stderr 。
+ *
+ *   throughput   : 不同消息大小的echo吞吐 , 每个连接保持depth个消息在途
+ *   connections  : 1到100k个连接的建连速率 , 以及全部连接同时pingpong的消息速率
+ *   fanin        : 多个非io线程同时向同一个会话发送 , 直到对端收完
+ *   http         : keep-alive下的请求速率 , depth大于1时为pipelining
+ *   websocket    : 客户端发送带掩码的帧 , 服务端解析后原样回复 , 分别测frame和view两种交付方式
+ *
+ * 速率类的结果先预热warmup毫秒 , 再统计duration毫秒内完成的消息数 。
+**/
+
+using namespace spdnet::net;
+
+struct bench_options {
+    io_backend backend{default_io_backend};
+    size_t server_threads{1};
+    size_t client_threads{1};
+    unsigned int warmup_ms{300};
+    unsigned int duration_ms{1000};
+    unsigned short port{29100};
+    size_t max_connections{100000};
+    bool quick{false};
+    std::string suite;
+    std::string label;
+    std::string out;
+};
+
+static const char *backend_name(io_backend backend) {
+    switch (backend) {
+        case io_backend::epoll:
+            return "epoll";
+        case io_backend::io_uring:
+            return "io_uring";
+        default:
+            return "iocp";
+    }
+}
+
+static std::vector<json_record> results;
+
+static void report(json_record record) {
+    fprintf(stderr, "%s\n", record.to_string().c_str());
+    results.push_back(std::move(record));
+}
+
+static size_t session_count(const event_service &service) {
+    size_t count = 0;
+    for (const auto &thread : service.get_service_threads())
+        count += thread->session_count();
+    return count;
+}
+
+static bool wait_until(const std::function<bool()> &done, unsigned int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// 尽量把打开文件数的软限制提到硬限制 , 返回最终的软限制
+static size_t raise_fd_limit() {
+#if defined(SPDNET_PLATFORM_LINUX)
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return 1024;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return limit.rlim_cur == RLIM_INFINITY ? static_cast<size_t>(-1) : static_cast<size_t>(limit.rlim_cur);
+#else
+    return static_cast<size_t>(-1);
+#endif
+}
+
+/*
+ * 客户端每发出一个request , 对端回复response_len字节 。
+ * 每个连接保持depth个request在途 , depth为0时只接收 ; handshake非空时先发送它 , 收到以空行结尾的回复后再开始 。
+**/
+struct pipeline_spec {
+    std::shared_ptr<const std::string> request;
+    size_t response_len{0};
+    size_t depth{1};
+    std::string handshake;
+};
+
+struct traffic_sample {
+    uint64_t messages{0};
+    uint64_t bytes{0};
+};
+
+class pipeline_client {
+public:
+    pipeline_client(event_service &service, pipeline_spec spec)
+            : connector_(service), spec_(std::move(spec)) {}
+
+    void connect(const end_point &addr) {
+        issued_++;
+        connector_.async_connect(addr, [this](std::shared_ptr<tcp_session> session) {
+            on_enter(std::move(session));
+        }, [this]() {
+            failed_++;
+        });
+    }
+
+    size_t issued() const { return issued_; }
+
+    size_t connected() const { return connected_.load(); }
+
+    size_t failed() const { return failed_.load(); }
+
+    // 完成握手、开始收发的连接数
+    size_t ready() const { return ready_.load(); }
+
+    traffic_sample sample() {
+        traffic_sample result;
+        std::lock_guard<std::mutex> lck(conns_guard_);
+        for (const auto &conn : conns_) {
+            result.messages += conn->messages.get();
+            result.bytes += conn->bytes.get();
+        }
+        return result;
+    }
+
+    // 停止发出新的request , 已在途的继续完成
+    void stop() {
+        stopping_ = true;
+    }
+
+    void shutdown_all() {
+        stop();
+        std::lock_guard<std::mutex> lck(conns_guard_);
+        for (const auto &conn : conns_)
+            conn->session->post_shutdown();
+    }
+
+private:
+    // 每个连接的状态只在它所属的io线程修改
+    struct connection {
+        std::shared_ptr<tcp_session> session;
+        spdnet::base::stat_counter messages;
+        spdnet::base::stat_counter bytes;
+        size_t partial{0};
+        bool handshaken{false};
+    };
+
+    void on_enter(std::shared_ptr<tcp_session> session) {
+        auto conn = new connection();
+        conn->session = session;
+        conn->handshaken = spec_.handshake.empty();
+        {
+            std::lock_guard<std::mutex> lck(conns_guard_);
+            conns_.emplace_back(conn);
+        }
+        session->set_no_delay();
+        session->set_data_callback([this, conn](const char *data, size_t len) -> size_t {
+            return on_data(*conn, data, len);
+        });
+        connected_++;
+        if (conn->handshaken)
+            start(*conn);
+        else
+            session->send(spec_.handshake.data(), spec_.handshake.size());
+    }
+
+    void start(connection &conn) {
+        ready_++;
+        for (size_t i = 0; i < spec_.depth && spec_.request != nullptr; i++)
+            conn.session->send(spec_.request);
+    }
+
+    size_t on_data(connection &conn, const char *data, size_t len) {
+        if (SPDNET_PREDICT_FALSE(!conn.handshaken)) {
+            static const char terminator[] = "\r\n\r\n";
+            auto end = std::search(data, data + len, terminator, terminator + 4);
+            if (end == data + len)
+                return 0;
+            conn.handshaken = true;
+            start(conn);
+            return static_cast<size_t>(end + 4 - data);
+        }
+        conn.bytes.add(len);
+        conn.partial += len;
+        bool resend = spec_.request != nullptr && !stopping_.load(std::memory_order_relaxed);
+        while (conn.partial >= spec_.response_len) {
+            conn.partial -= spec_.response_len;
+            conn.messages.add();
+            if (resend)
+                conn.session->send(spec_.request);
+        }
+        return len;
+    }
+
+private:
+    async_connector connector_;
+    pipeline_spec spec_;
+    std::atomic_bool stopping_{false};
+    size_t issued_{0};
+    std::atomic<size_t> connected_{0};
+    std::atomic<size_t> failed_{0};
+    std::atomic<size_t> ready_{0};
+    std::mutex conns_guard_;
+    std::vector<std::unique_ptr<connection>> conns_;
+};
+
+struct rate_result {
+    double messages_per_sec{0};
+    double bytes_per_sec{0};
+};
+
+// 预热后统计duration内完成的消息数
+static rate_result measure_rate(const bench_options &options, pipeline_client &client) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.warmup_ms));
+    auto begin_sample = client.sample();
+    auto begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+    auto end_sample = client.sample();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    rate_result result;
+    result.messages_per_sec = static_cast<double>(end_sample.messages - begin_sample.messages) / sec;
+    result.bytes_per_sec = static_cast<double>(end_sample.bytes - begin_sample.bytes) / sec;
+    return result;
+}
+
+// 关闭客户端连接 , 等两端的会话都释放 , 下一项测试不受影响
+static void teardown(pipeline_client &client, event_service &server, event_service &client_service) {
+    client.shutdown_all();
+    if (!wait_until([&]() { return session_count(server) == 0 && session_count(client_service) == 0; }, 30000))
+        fprintf(stderr, "warning : sessions still alive after teardown\n");
+}
+
+class bench_case {
+public:
+    explicit bench_case(const bench_options &options)
+            : server(options.backend), client(options.backend) {
+        server.run_thread(options.server_threads);
+        client.run_thread(options.client_threads);
+    }
+
+    event_service server;
+    event_service client;
+};
+
+static unsigned short next_port(const bench_options &options) {
+    static unsigned short offset = 0;
+    return static_cast<unsigned short>(options.port + offset++);
+}
+
+static void start_echo_server(tcp_acceptor &acceptor, unsigned short port) {
+    acceptor.set_backlog(4096);
+    acceptor.start(end_point::ipv4("127.0.0.1", port), [](std::shared_ptr<tcp_session> session) {
+        session->set_no_delay();
+        session->set_data_callback([session](const char *data, size_t len) -> size_t {
+            session->send(data, len);
+            return len;
+        });
+    });
+}
+
+static void run_throughput(const bench_options &options) {
+    const size_t conns = 4;
+    const size_t depth = 8;
+    std::vector<size_t> sizes = {64, 1024, 16 * 1024, 64 * 1024, 1024 * 1024};
+    if (options.quick)
+        sizes = {64, 16 * 1024};
+    for (size_t size : sizes) {
+        bench_case bench(options);
+        tcp_acceptor acceptor(bench.server);
+        unsigned short port = next_port(options);
+        start_echo_server(acceptor, port);
+
+        pipeline_spec spec;
+        spec.request = std::make_shared<const std::string>(size, 'x');
+        spec.response_len = size;
+        spec.depth = depth;
+        pipeline_client client(bench.client, spec);
+        for (size_t i = 0; i < conns; i++)
+            client.connect(end_point::ipv4("127.0.0.1", port));
+        wait_until([&]() { return client.ready() + client.failed() == conns; }, 10000);
+
+        auto rate = measure_rate(options, client);
+        report(json_record().add_string("suite", "throughput")
+                       .add_count("msg_size", size)
+                       .add_count("conns", client.ready())
+                       .add_count("depth", depth)
+                       .add_number("msgs_per_sec", rate.messages_per_sec)
+                       .add_number("mb_per_sec", rate.bytes_per_sec / (1024 * 1024)));
+        teardown(client, bench.server, bench.client);
+    }
+}
+
+static void run_connections(const bench_options &options) {
+    // 同一对地址的连接数受本地端口范围限制 , 按需多监听几个端口
+    const size_t conns_per_port = 20000;
+    const size_t max_connecting = 512;
+    size_t fd_limit = raise_fd_limit();
+    std::vector<size_t> counts = {1, 100, 1000, 10000, 100000};
+    if (options.quick)
+        counts = {1, 100, 1000};
+    for (size_t count : counts) {
+        if (count > options.max_connections)
+            continue;
+        // 两端各占一个fd , 另留一些给监听socket和后端自身
+        if (fd_limit != static_cast<size_t>(-1) && count * 2 + 256 > fd_limit) {
+            report(json_record().add_string("suite", "connections")
+                           .add_count("conns", count)
+                           .add_string("skipped", "fd limit " + std::to_string(fd_limit)));
+            continue;
+        }
+        bench_case bench(options);
+        std::vector<std::unique_ptr<tcp_acceptor>> acceptors;
+        std::vector<unsigned short> ports;
+        for (size_t i = 0; i < (count + conns_per_port - 1) / conns_per_port; i++) {
+            ports.push_back(next_port(options));
+            acceptors.emplace_back(new tcp_acceptor(bench.server));
+            start_echo_server(*acceptors.back(), ports.back());
+        }
+
+        pipeline_spec spec;
+        spec.request = std::make_shared<const std::string>(64, 'x');
+        spec.response_len = 64;
+        spec.depth = 1;
+        pipeline_client client(bench.client, spec);
+
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            while (client.issued() - client.connected() - client.failed() >= max_connecting)
+                std::this_thread::yield();
+            client.connect(end_point::ipv4("127.0.0.1", ports[i / conns_per_port]));
+        }
+        wait_until([&]() { return client.ready() + client.failed() == count; }, 60000);
+        double connect_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        auto rate = measure_rate(options, client);
+        report(json_record().add_string("suite", "connections")
+                       .add_count("conns", client.ready())
+                       .add_count("failed", client.failed())
+                       .add_number("connect_sec", connect_sec)
+                       .add_number("connects_per_sec", static_cast<double>(client.ready()) / connect_sec)
+                       .add_number("msgs_per_sec", rate.messages_per_sec));
+        teardown(client, bench.server, bench.client);
+    }
+}
+
+static void run_fanin(const bench_options &options) {
+    const size_t msg_size = 64;
+    size_t total_messages = options.quick ? 200000 : 1000000;
+    std::vector<size_t> producer_nums = {1, 4, 16};
+    if (options.quick)
+        producer_nums = {1, 4};
+    for (size_t producer_num : producer_nums) {
+        bench_case bench(options);
+        tcp_acceptor acceptor(bench.server);
+        unsigned short port = next_port(options);
+        std::mutex session_guard;
+        std::shared_ptr<tcp_session> server_session;
+        acceptor.start(end_point::ipv4("127.0.0.1", port), [&](std::shared_ptr<tcp_session> session) {
+            session->set_no_delay();
+            std::lock_guard<std::mutex> lck(session_guard);
+            server_session = session;
+        });
+
+        pipeline_spec spec;
+        spec.response_len = msg_size;
+        spec.depth = 0;
+        pipeline_client client(bench.client, spec);
+        client.connect(end_point::ipv4("127.0.0.1", port));
+        wait_until([&]() {
+            std::lock_guard<std::mutex> lck(session_guard);
+            return server_session != nullptr;
+        }, 10000);
+        std::shared_ptr<tcp_session> session;
+        {
+            std::lock_guard<std::mutex> lck(session_guard);
+            session = server_session;
+        }
+        if (session == nullptr) {
+            report(json_record().add_string("suite", "fanin").add_count("producers", producer_num).add_string("skipped", "connect failed"));
+            continue;
+        }
+
+        size_t per_producer = total_messages / producer_num;
+        size_t expected = per_producer * producer_num;
+        std::atomic_bool start{false};
+        std::vector<std::thread> producers;
+        for (size_t i = 0; i < producer_num; i++) {
+            producers.emplace_back([&]() {
+                char payload[msg_size];
+                memset(payload, 'x', sizeof(payload));
+                while (!start)
+                    std::this_thread::yield();
+                for (size_t n = 0; n < per_producer; n++)
+                    session->send(payload, sizeof(payload));
+            });
+        }
+        auto begin = std::chrono::steady_clock::now();
+        start = true;
+        for (auto &t : producers)
+            t.join();
+        double post_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        bool finished = wait_until([&]() { return client.sample().messages >= expected; }, 60000);
+        double total_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        report(json_record().add_string("suite", "fanin")
+                       .add_count("producers", producer_num)
+                       .add_count("msg_size", msg_size)
+                       .add_count("messages", expected)
+                       .add_count("complete", finished ? 1 : 0)
+                       .add_number("post_ns_per_msg", post_sec * 1e9 / static_cast<double>(expected))
+                       .add_number("msgs_per_sec", static_cast<double>(client.sample().messages) / total_sec));
+        session = nullptr;
+        server_session = nullptr;
+        teardown(client, bench.server, bench.client);
+    }
+}
+
+static void run_http(const bench_options &options) {
+    const size_t conns = 4;
+    const std::string body = "<html>hello spdnet</html>";
+    std::vector<size_t> depths = {1, 16};
+    for (size_t depth : depths) {
+        bench_case bench(options);
+        http::http_server server(bench.server);
+        unsigned short port = next_port(options);
+        server.start(end_point::ipv4("127.0.0.1", port), [body](std::shared_ptr<http::http_session> session) {
+            session->set_http_request_callback([body](const http::http_request &,
+                                                      std::shared_ptr<http::http_session> session) {
+                http::http_response response;
+                response.set_body(body);
+                session->send_response(response);
+            });
+            session->under_tcp_session()->set_no_delay();
+        });
+
+        // 服务端每次回复的内容都相同 , 按字节数切分响应
+        http::http_response response;
+        response.set_body(body);
+        pipeline_spec spec;
+        spec.request = std::make_shared<const std::string>("GET /bench HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+        spec.response_len = response.to_string().size();
+        spec.depth = depth;
+        pipeline_client client(bench.client, spec);
+        for (size_t i = 0; i < conns; i++)
+            client.connect(end_point::ipv4("127.0.0.1", port));
+        wait_until([&]() { return client.ready() + client.failed() == conns; }, 10000);
+
+        auto rate = measure_rate(options, client);
+        report(json_record().add_string("suite", "http")
+                       .add_count("conns", client.ready())
+                       .add_count("pipeline_depth", depth)
+                       .add_number("requests_per_sec", rate.messages_per_sec));
+        teardown(client, bench.server, bench.client);
+    }
+}
+
+static void run_websocket(const bench_options &options) {
+    const size_t conns = 4;
+    const size_t depth = 16;
+    std::vector<size_t> payload_sizes = {16, 1024, 16 * 1024};
+    if (options.quick)
+        payload_sizes = {16, 1024};
+    for (size_t payload_size : payload_sizes) {
+        // frame : 负载拷贝在websocket_frame里交付 ; view : 在接收缓冲区原地去掩码 , 以视图交付
+        for (bool view : {false, true}) {
+            bench_case bench(options);
+            http::http_server server(bench.server);
+            unsigned short port = next_port(options);
+            server.start(end_point::ipv4("127.0.0.1", port), [view](std::shared_ptr<http::http_session> session) {
+                if (view) {
+                    session->set_ws_frame_view_callback([](http::ws_opcode opcode, spdnet::base::string_view payload,
+                                                           std::shared_ptr<http::http_session> session) {
+                        http::websocket_frame reply(payload.data(), payload.size(), opcode, true, false);
+                        session->send_ws_frame(reply);
+                    });
+                } else {
+                    session->set_ws_frame_enter_callback([](const http::websocket_frame &frame,
+                                                            std::shared_ptr<http::http_session> session) {
+                        http::websocket_frame reply(frame.get_payload(), frame.get_opcode(), true, false);
+                        session->send_ws_frame(reply);
+                    });
+                }
+                session->under_tcp_session()->set_no_delay();
+            });
+
+            std::string payload(payload_size, 'w');
+            http::websocket_frame request(payload, http::ws_opcode::op_binary_frame, true, true);
+            http::websocket_frame reply(payload, http::ws_opcode::op_binary_frame, true, false);
+            pipeline_spec spec;
+            spec.request = std::make_shared<const std::string>(request.to_string());
+            spec.response_len = reply.to_string().size();
+            spec.depth = depth;
+            spec.handshake = "GET /ws HTTP/1.1\r\n"
+                             "Host: 127.0.0.1\r\n"
+                             "Upgrade: websocket\r\n"
+                             "Connection: Upgrade\r\n"
+                             "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                             "Sec-WebSocket-Version: 13\r\n\r\n";
+            pipeline_client client(bench.client, spec);
+            for (size_t i = 0; i < conns; i++)
+                client.connect(end_point::ipv4("127.0.0.1", port));
+            wait_until([&]() { return client.ready() + client.failed() == conns; }, 10000);
+
+            auto rate = measure_rate(options, client);
+            report(json_record().add_string("suite", "websocket")
+                           .add_string("mode", view ? "view" : "frame")
+                           .add_count("payload_size", payload_size)
+                           .add_count("conns", client.ready())
+                           .add_count("depth", depth)
+                           .add_number("frames_per_sec", rate.messages_per_sec)
+                           .add_number("mb_per_sec", rate.bytes_per_sec / (1024 * 1024)));
+            teardown(client, bench.server, bench.client);
+        }
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage : [--backend=epoll|io_uring] [--server-threads=N] [--client-threads=N]\n"
+                    "        [--warmup=ms] [--duration=ms] [--port=N] [--max-connections=N] [--quick]\n"
+                    "        [--suite=throughput|connections|fanin|http|websocket] [--label=str] [--out=file]\n");
+    exit(-1);
+}
+
+static bench_options parse_options(int argc, char *argv[]) {
+    bench_options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string key = arg;
+        std::string value;
+        auto pos = arg.find('=');
+        if (pos != std::string::npos) {
+            key = arg.substr(0, pos);
+            value = arg.substr(pos + 1);
+        }
+        if (key == "--backend") {
+            if (value == "epoll")
+                options.backend = io_backend::epoll;
+            else if (value == "io_uring")
+                options.backend = io_backend::io_uring;
+            else
+                usage();
+        } else if (key == "--server-threads") {
+            options.server_threads = static_cast<size_t>(atoi(value.c_str()));
+        } else if (key == "--client-threads") {
+            options.client_threads = static_cast<size_t>(atoi(value.c_str()));
+        } else if (key == "--warmup") {
+            options.warmup_ms = static_cast<unsigned int>(atoi(value.c_str()));
+        } else if (key == "--duration") {
+            options.duration_ms = static_cast<unsigned int>(atoi(value.c_str()));
+        } else if (key == "--port") {
+            options.port = static_cast<unsigned short>(atoi(value.c_str()));
+        } else if (key == "--max-connections") {
+            options.max_connections = static_cast<size_t>(atoll(value.c_str()));
+        } else if (key == "--quick") {
+            options.quick = true;
+        } else if (key == "--suite") {
+            options.suite = value;
+        } else if (key == "--label") {
+            options.label = value;
+        } else if (key == "--out") {
+            options.out = value;
+        } else {
+            usage();
+        }
+    }
+    if (options.server_threads == 0 || options.client_threads == 0 || options.duration_ms == 0)
+        usage();
+    return options;
+}
+
+int main(int argc, char *argv[]) {
+    bench_options options = parse_options(argc, argv);
+    if (options.quick) {
+        options.warmup_ms = (std::min)(options.warmup_ms, 100u);
+        options.duration_ms = (std::min)(options.duration_ms, 300u);
+    }
+
+    // 后端不可用时service_thread会回退 , 记录实际使用的后端
+    io_backend actual_backend;
+    {
+        event_service probe(options.backend);
+        probe.run_thread(1);
+        actual_backend = probe.get_service_threads()[0]->backend();
+    }
+
+    const std::pair<const char *, void (*)(const bench_options &)> suites[] = {
+            {"throughput",  run_throughput},
+            {"connections", run_connections},
+            {"fanin",       run_fanin},
+            {"http",        run_http},
+            {"websocket",   run_websocket},
+    };
+    bool matched = false;
+    for (const auto &suite : suites) {
+        if (!options.suite.empty() && options.suite != suite.first)
+            continue;
+        matched = true;
+        suite.second(options);
+    }
+    if (!matched)
+        usage();
+
+    json_record header;
+    header.add_string("benchmark", "spdnet_loopback")
+            .add_string("label", options.label)
+            .add_count("timestamp", static_cast<uint64_t>(time(nullptr)))
+            .add_string("backend", backend_name(actual_backend))
+            .add_count("server_threads", options.server_threads)
+            .add_count("client_threads", options.client_threads)
+            .add_count("warmup_ms", options.warmup_ms)
+            .add_count("duration_ms", options.duration_ms);
+    if (!write_json_report(header, results, options.out))
+        return -1;
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <spdnet/base/buffer.h>
+#include <spdnet/base/buffer_pool.h>
+#include <spdnet/base/stat_counter.h>
+#include <spdnet/net/task_executor.h>
+#include <spdnet/net/http/http_parser.h>
+#include <spdnet/net/http/http_parser_api.h>
+#include <spdnet/net/http/websocket_mask.h>
+#include "micro_bench.h"
+
+/*
+ * 热点组件的微基准 , 不涉及网络 , 用于把端到端测试里的变化定位到具体组件 。
+ * 结果格式与loopback_bench相同 , 见micro_bench.h 。
+**/
+
+using bench_state = micro_bench::state;
+using spdnet::base::buffer;
+using spdnet::base::buffer_pool;
+
+// 从最小容量开始逐块写入64KB , 包含扩容
+static void bm_buffer_write_grow(bench_state &state) {
+    const size_t chunk = static_cast<size_t>(state.arg());
+    const size_t total = 64 * 1024;
+    std::vector<char> data(chunk, 'x');
+    while (state.keep_running()) {
+        buffer buf;
+        for (size_t len = 0; len < total; len += chunk)
+            buf.write(data.data(), chunk);
+        micro_bench::do_not_optimize(buf.get_data_ptr());
+    }
+    state.set_bytes_processed(state.iterations() * total);
+}
+
+// 容量已经足够 , 只有拷贝
+static void bm_buffer_write_reuse(bench_state &state) {
+    const size_t chunk = static_cast<size_t>(state.arg());
+    const size_t total = 64 * 1024;
+    std::vector<char> data(chunk, 'x');
+    buffer buf(total);
+    while (state.keep_running()) {
+        buf.clear();
+        for (size_t len = 0; len < total; len += chunk)
+            buf.write(data.data(), chunk);
+        micro_bench::do_not_optimize(buf.get_data_ptr());
+    }
+    state.set_bytes_processed(state.iterations() * total);
+}
+
+static void bm_buffer_new_delete(bench_state &state) {
+    const size_t size = static_cast<size_t>(state.arg());
+    while (state.keep_running()) {
+        auto buf = new buffer(size);
+        micro_bench::do_not_optimize(buf);
+        delete buf;
+    }
+    state.set_items_processed(state.iterations());
+}
+
+static void bm_buffer_pool_alloc_recycle(bench_state &state) {
+    const size_t size = static_cast<size_t>(state.arg());
+    auto &pool = buffer_pool::instance();
+    while (state.keep_running()) {
+        auto buf = pool.alloc_buffer(size);
+        micro_bench::do_not_optimize(buf);
+        pool.recycle_buffer(buf);
+    }
+    state.set_items_processed(state.iterations());
+}
+
+// 一次分配多个再全部回收 , 超出线程缓存的部分经过全局仓库
+static void bm_buffer_pool_batch(bench_state &state) {
+    const size_t size = static_cast<size_t>(state.arg());
+    const size_t batch = 256;
+    auto &pool = buffer_pool::instance();
+    std::vector<buffer *> buffers(batch);
+    while (state.keep_running()) {
+        for (size_t i = 0; i < batch; i++)
+            buffers[i] = pool.alloc_buffer(size);
+        micro_bench::clobber_memory();
+        for (size_t i = 0; i < batch; i++)
+            pool.recycle_buffer(buffers[i]);
+    }
+    state.set_items_processed(state.iterations() * batch);
+}
+
+class null_wakeup : public spdnet::net::wakeup_base {
+public:
+    void wakeup() override {
+        wakeup_count_++;
+    }
+
+    uint64_t wakeup_count_{0};
+};
+
+class atomic_wakeup : public spdnet::net::wakeup_base {
+public:
+    void wakeup() override {
+        wakeup_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> wakeup_count_{0};
+};
+
+// 在io线程投递 , 立即执行
+static void bm_task_executor_post_immediate(bench_state &state) {
+    null_wakeup wakeup;
+    spdnet::net::task_executor executor(&wakeup);
+    executor.set_thread_id(spdnet::net::current_thread::tid());
+    uint64_t executed = 0;
+    while (state.keep_running())
+        executor.post([&executed]() { executed++; });
+    micro_bench::do_not_optimize(executed);
+    state.set_items_processed(state.iterations());
+}
+
+// 在io线程投递到本轮末尾 , 每1024个执行一次run
+static void bm_task_executor_post_deferred(bench_state &state) {
+    null_wakeup wakeup;
+    spdnet::net::task_executor executor(&wakeup);
+    executor.set_thread_id(spdnet::net::current_thread::tid());
+    uint64_t executed = 0;
+    uint64_t posted = 0;
+    while (state.keep_running()) {
+        executor.post([&executed]() { executed++; }, false);
+        if (++posted % 1024 == 0)
+            executor.run();
+    }
+    executor.run();
+    micro_bench::do_not_optimize(executed);
+    state.set_items_processed(state.iterations());
+}
+
+/*
+ * 从其它线程投递 , 一个消费线程不断run 。arg是投递线程总数 , 除计时线程外的投递线程持续制造竞争 。
+ * 积压超过max_backlog时投递方让出cpu , 避免消费跟不上时内存无限增长 。
+**/
+static void bm_task_executor_post_cross_thread(bench_state &state) {
+    const size_t producer_num = static_cast<size_t>(state.arg());
+    const uint64_t max_backlog = 64 * 1024;
+    atomic_wakeup wakeup;
+    spdnet::net::task_executor executor(&wakeup);
+    spdnet::base::stat_counter executed;
+    std::atomic<uint64_t> posted{0};
+    std::atomic_bool stop{false};
+    std::atomic_bool consumer_ready{false};
+
+    std::thread consumer([&]() {
+        executor.set_thread_id(spdnet::net::current_thread::tid());
+        consumer_ready = true;
+        while (!stop || executed.get() < posted.load())
+            executor.run();
+    });
+    while (!consumer_ready)
+        std::this_thread::yield();
+
+    auto post_one = [&]() {
+        while (posted.load(std::memory_order_relaxed) - executed.get() > max_backlog)
+            std::this_thread::yield();
+        posted.fetch_add(1, std::memory_order_relaxed);
+        executor.post([&executed]() { executed.add(); });
+    };
+    std::vector<std::thread> producers;
+    for (size_t i = 1; i < producer_num; i++) {
+        producers.emplace_back([&]() {
+            while (!stop)
+                post_one();
+        });
+    }
+
+    while (state.keep_running())
+        post_one();
+
+    stop = true;
+    for (auto &t : producers)
+        t.join();
+    consumer.join();
+    state.set_items_processed(state.iterations());
+}
+
+static std::string make_get_request() {
+    return "GET /index.html?key1=val1&key2=val2 HTTP/1.1\r\n"
+           "Host: www.example.com\r\n"
+           "User-Agent: spdnet-micro-bench\r\n"
+           "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+           "Accept-Encoding: gzip, deflate\r\n"
+           "Accept-Language: en-US,en;q=0.5\r\n"
+           "Cookie: session=0123456789abcdef; theme=dark\r\n"
+           "Connection: keep-alive\r\n"
+           "\r\n";
+}
+
+static std::string make_post_request(size_t body_len) {
+    std::string request = "POST /api/upload HTTP/1.1\r\n"
+                          "Host: www.example.com\r\n"
+                          "Content-Type: application/octet-stream\r\n"
+                          "Connection: keep-alive\r\n";
+    request += "Content-Length: " + std::to_string(body_len) + "\r\n\r\n";
+    return request + std::string(body_len, 'b');
+}
+
+static void run_request_parse(bench_state &state, std::string data, size_t requests_per_parse) {
+    spdnet::net::http::websocket_parser ws_parser;
+    spdnet::net::http::http_request_parser parser(ws_parser);
+    uint64_t completed = 0;
+    parser.set_parse_complete_callback([&completed](const spdnet::net::http::http_request &) {
+        completed++;
+    });
+    while (state.keep_running())
+        parser.try_parse(&data[0], data.size());
+    if (completed != state.iterations() * requests_per_parse)
+        fprintf(stderr, "warning : parsed %llu requests , expected %llu\n",
+                static_cast<unsigned long long>(completed),
+                static_cast<unsigned long long>(state.iterations() * requests_per_parse));
+    state.set_items_processed(completed);
+    state.set_bytes_processed(state.iterations() * data.size());
+}
+
+// arg个GET请求在同一次try_parse里 , 大于1时相当于pipelining
+static void bm_http_request_parse_get(bench_state &state) {
+    const size_t count = static_cast<size_t>(state.arg());
+    std::string data;
+    for (size_t i = 0; i < count; i++)
+        data += make_get_request();
+    run_request_parse(state, data, count);
+}
+
+// 带arg字节body的POST请求
+static void bm_http_request_parse_post(bench_state &state) {
+    run_request_parse(state, make_post_request(static_cast<size_t>(state.arg())), 1);
+}
+
+// view为true时以视图交付 , 负载在data里原地去掩码 ; 掩码变换是对合 , 重复解析同一份数据不影响计时
+static void run_websocket_parse(bench_state &state, bool mask, bool view) {
+    const size_t payload_len = static_cast<size_t>(state.arg());
+    spdnet::net::http::websocket_frame frame(std::string(payload_len, 'w'),
+                                             spdnet::net::http::ws_opcode::op_binary_frame, true, mask);
+    std::string data = frame.to_string();
+    spdnet::net::http::websocket_parser parser;
+    uint64_t completed = 0;
+    if (view) {
+        parser.set_ws_frame_view_callback([&completed](spdnet::net::http::ws_opcode,
+                                                       spdnet::base::string_view payload) {
+            micro_bench::do_not_optimize(payload.data());
+            completed++;
+        });
+    } else {
+        parser.set_ws_frame_complete_callback([&completed](spdnet::net::http::websocket_frame &frame) {
+            micro_bench::do_not_optimize(frame.get_payload().data());
+            completed++;
+        });
+    }
+    while (state.keep_running())
+        parser.try_ws_parse(&data[0], data.size());
+    state.set_items_processed(completed);
+    state.set_bytes_processed(state.iterations() * payload_len);
+}
+
+static void bm_websocket_parse_masked(bench_state &state) {
+    run_websocket_parse(state, true, false);
+}
+
+static void bm_websocket_parse_unmasked(bench_state &state) {
+    run_websocket_parse(state, false, false);
+}
+
+static void bm_websocket_parse_view_masked(bench_state &state) {
+    run_websocket_parse(state, true, true);
+}
+
+static void bm_websocket_parse_view_unmasked(bench_state &state) {
+    run_websocket_parse(state, false, true);
+}
+
+// 单独测掩码内核 , 不含解析和拷贝
+static void run_websocket_mask(bench_state &state, spdnet::net::http::detail::websocket_mask_function kernel) {
+    const size_t len = static_cast<size_t>(state.arg());
+    std::vector<uint8_t> data(len, 'w');
+    while (state.keep_running()) {
+        kernel(data.data(), len, 0x12345678);
+        micro_bench::do_not_optimize(data.data());
+    }
+    state.set_bytes_processed(state.iterations() * len);
+}
+
+static void bm_websocket_mask_dispatch(bench_state &state) {
+    run_websocket_mask(state, spdnet::net::http::detail::websocket_mask_kernel());
+}
+
+static void bm_websocket_mask_scalar(bench_state &state) {
+    run_websocket_mask(state, spdnet::net::http::detail::websocket_mask_scalar);
+}
+
+int main(int argc, char *argv[]) {
+    micro_bench::runner runner(argc, argv);
+    runner.add("buffer_write_grow", bm_buffer_write_grow).args({16, 256, 4096});
+    runner.add("buffer_write_reuse", bm_buffer_write_reuse).args({16, 256, 4096});
+    runner.add("buffer_new_delete", bm_buffer_new_delete).args({1024, 16 * 1024});
+    runner.add("buffer_pool_alloc_recycle", bm_buffer_pool_alloc_recycle).args({1024, 16 * 1024})
+            .threads({1, 2, 4, 8});
+    runner.add("buffer_pool_batch", bm_buffer_pool_batch).args({4096}).threads({1, 4});
+    runner.add("task_executor_post_immediate", bm_task_executor_post_immediate);
+    runner.add("task_executor_post_deferred", bm_task_executor_post_deferred);
+    runner.add("task_executor_post_cross_thread", bm_task_executor_post_cross_thread).args({1, 4});
+    runner.add("http_request_parse_get", bm_http_request_parse_get).args({1, 16});
+    runner.add("http_request_parse_post", bm_http_request_parse_post).args({4096});
+    runner.add("websocket_parse_masked", bm_websocket_parse_masked).args({16, 1024, 64 * 1024});
+    runner.add("websocket_parse_unmasked", bm_websocket_parse_unmasked).args({16, 1024, 64 * 1024});
+    runner.add("websocket_parse_view_masked", bm_websocket_parse_view_masked).args({16, 1024, 64 * 1024});
+    runner.add("websocket_parse_view_unmasked", bm_websocket_parse_view_unmasked).args({16, 1024, 64 * 1024});
+    runner.add(std::string("websocket_mask_") + spdnet::net::http::detail::websocket_mask_isa(),
+               bm_websocket_mask_dispatch).args({64, 1024, 64 * 1024});
+    runner.add("websocket_mask_scalar", bm_websocket_mask_scalar).args({64, 1024, 64 * 1024});
+    return runner.run();
+}
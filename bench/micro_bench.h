@@ -0,0 +1,326 @@
+#ifndef SPDNET_BENCH_MICRO_BENCH_H_
+#define SPDNET_BENCH_MICRO_BENCH_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <spdnet/base/platform.h>
+#include "bench_json.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+ * 不依赖网络和第三方库的微基准框架 , 用法与Google Benchmark相近 :
+ *
+ *   void bm_xxx(micro_bench::state &state) {
+ *       // 准备 , 不计时
+ *       while (state.keep_running()) {
+ *           // 被测代码
+ *       }
+ *       state.set_items_processed(state.iterations());
+ *   }
+ *   runner.add("xxx", bm_xxx).args({64, 4096}).threads({1, 4});
+ *
+ * 迭代次数从1开始按耗时估算放大 , 直到单次运行不短于min_time 。
+ * 多线程时每个线程执行相同的迭代次数 , 同时开始 , ns_per_op是各线程耗时的平均值除以迭代次数 。
+**/
+namespace micro_bench {
+    template<typename T>
+    inline void do_not_optimize(const T &value) {
+#if defined(_MSC_VER)
+        static const volatile void *sink;
+        sink = &value;
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    inline void clobber_memory() {
+#if defined(_MSC_VER)
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    // 让同一次运行的线程同时开始
+    class barrier {
+    public:
+        explicit barrier(size_t count) : count_(count) {}
+
+        void wait() {
+            std::unique_lock<std::mutex> lck(mutex_);
+            size_t generation = generation_;
+            if (++arrived_ == count_) {
+                arrived_ = 0;
+                generation_++;
+                cond_.notify_all();
+                return;
+            }
+            cond_.wait(lck, [this, generation]() { return generation != generation_; });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        size_t count_;
+        size_t arrived_{0};
+        size_t generation_{0};
+    };
+
+    class state {
+    public:
+        state(uint64_t iterations, int64_t arg, size_t threads, size_t thread_index, barrier *start_barrier)
+                : max_iterations_(iterations), arg_(arg), threads_(threads), thread_index_(thread_index),
+                  start_barrier_(start_barrier) {}
+
+        // 第一次调用时开始计时 , 返回false时停止计时
+        bool keep_running() {
+            if (SPDNET_PREDICT_TRUE(count_ != 0)) {
+                count_--;
+                return true;
+            }
+            if (!started_) {
+                started_ = true;
+                start_barrier_->wait();
+                count_ = max_iterations_;
+                begin_ = std::chrono::steady_clock::now();
+                if (count_ == 0)
+                    return false;
+                count_--;
+                return true;
+            }
+            elapsed_ += std::chrono::steady_clock::now() - begin_;
+            return false;
+        }
+
+        // 暂停计时 , 用于每轮都要做、但不属于被测部分的准备工作
+        void pause_timing() {
+            elapsed_ += std::chrono::steady_clock::now() - begin_;
+        }
+
+        void resume_timing() {
+            begin_ = std::chrono::steady_clock::now();
+        }
+
+        uint64_t iterations() const { return max_iterations_; }
+
+        int64_t arg() const { return arg_; }
+
+        size_t threads() const { return threads_; }
+
+        size_t thread_index() const { return thread_index_; }
+
+        void set_items_processed(uint64_t items) { items_ = items; }
+
+        void set_bytes_processed(uint64_t bytes) { bytes_ = bytes; }
+
+        std::chrono::steady_clock::duration elapsed() const { return elapsed_; }
+
+        uint64_t items_processed() const { return items_; }
+
+        uint64_t bytes_processed() const { return bytes_; }
+
+    private:
+        uint64_t max_iterations_;
+        uint64_t count_{0};
+        bool started_{false};
+        int64_t arg_;
+        size_t threads_;
+        size_t thread_index_;
+        barrier *start_barrier_;
+        std::chrono::steady_clock::time_point begin_;
+        std::chrono::steady_clock::duration elapsed_{0};
+        uint64_t items_{0};
+        uint64_t bytes_{0};
+    };
+
+    using bench_function = std::function<void(state &)>;
+
+    class bench_entry {
+    public:
+        bench_entry(std::string name, bench_function func)
+                : name_(std::move(name)), func_(std::move(func)) {}
+
+        bench_entry &args(std::vector<int64_t> values) {
+            args_ = std::move(values);
+            return *this;
+        }
+
+        bench_entry &threads(std::vector<size_t> values) {
+            threads_ = std::move(values);
+            return *this;
+        }
+
+    private:
+        friend class runner;
+
+        std::string name_;
+        bench_function func_;
+        std::vector<int64_t> args_{0};
+        std::vector<size_t> threads_{1};
+    };
+
+    struct run_result {
+        uint64_t iterations{0};
+        double seconds{0};
+        uint64_t items{0};
+        uint64_t bytes{0};
+    };
+
+    class runner {
+    public:
+        runner(int argc, char *argv[]) {
+            for (int i = 1; i < argc; i++) {
+                std::string arg = argv[i];
+                std::string key = arg;
+                std::string value;
+                auto pos = arg.find('=');
+                if (pos != std::string::npos) {
+                    key = arg.substr(0, pos);
+                    value = arg.substr(pos + 1);
+                }
+                if (key == "--filter")
+                    filter_ = value;
+                else if (key == "--min-time")
+                    min_time_ms_ = static_cast<unsigned int>(atoi(value.c_str()));
+                else if (key == "--label")
+                    label_ = value;
+                else if (key == "--out")
+                    out_ = value;
+                else if (key == "--list")
+                    list_only_ = true;
+                else
+                    usage();
+            }
+            if (min_time_ms_ == 0)
+                usage();
+        }
+
+        bench_entry &add(std::string name, bench_function func) {
+            entries_.emplace_back(new bench_entry(std::move(name), std::move(func)));
+            return *entries_.back();
+        }
+
+        int run() {
+            std::vector<json_record> results;
+            for (const auto &entry : entries_) {
+                for (int64_t arg : entry->args_) {
+                    for (size_t threads : entry->threads_) {
+                        std::string name = entry->name_;
+                        if (entry->args_.size() > 1 || arg != 0)
+                            name += "/" + std::to_string(arg);
+                        if (entry->threads_.size() > 1 || threads != 1)
+                            name += "/threads:" + std::to_string(threads);
+                        if (!filter_.empty() && name.find(filter_) == std::string::npos)
+                            continue;
+                        if (list_only_) {
+                            fprintf(stdout, "%s\n", name.c_str());
+                            continue;
+                        }
+                        results.push_back(measure(name, *entry, arg, threads));
+                    }
+                }
+            }
+            if (list_only_)
+                return 0;
+
+            json_record header;
+            header.add_string("benchmark", "spdnet_micro")
+                    .add_string("label", label_)
+                    .add_count("timestamp", static_cast<uint64_t>(time(nullptr)))
+                    .add_count("min_time_ms", min_time_ms_);
+            return write_json_report(header, results, out_) ? 0 : -1;
+        }
+
+    private:
+        json_record measure(const std::string &name, const bench_entry &entry, int64_t arg, size_t threads) {
+            double min_sec = min_time_ms_ / 1000.0;
+            uint64_t iterations = 1;
+            run_result result;
+            while (true) {
+                result = run_once(entry, arg, threads, iterations);
+                if (result.seconds >= min_sec || iterations >= max_iterations)
+                    break;
+                // 按已用时间估算需要的次数 , 多留40% , 每次最多放大10倍
+                double multiplier = result.seconds > 0 ? min_sec * 1.4 / result.seconds : 10.0;
+                multiplier = (std::min)(10.0, (std::max)(multiplier, 2.0));
+                iterations = (std::min)(static_cast<uint64_t>(max_iterations), static_cast<uint64_t>(iterations * multiplier));
+            }
+
+            double ns_per_op = result.seconds * 1e9 / static_cast<double>(result.iterations);
+            json_record record;
+            record.add_string("name", name)
+                    .add_count("arg", static_cast<uint64_t>(arg))
+                    .add_count("threads", threads)
+                    .add_count("iterations", result.iterations)
+                    .add_number("ns_per_op", ns_per_op);
+            // 各线程的处理量相加 , 除以平均耗时
+            if (result.items > 0)
+                record.add_number("items_per_sec", static_cast<double>(result.items) / result.seconds);
+            if (result.bytes > 0)
+                record.add_number("mb_per_sec", static_cast<double>(result.bytes) / result.seconds / (1024 * 1024));
+            fprintf(stderr, "%-48s %12llu %12.1f ns/op", name.c_str(),
+                    static_cast<unsigned long long>(result.iterations), ns_per_op);
+            if (result.items > 0)
+                fprintf(stderr, " %12.0f items/s", static_cast<double>(result.items) / result.seconds);
+            if (result.bytes > 0)
+                fprintf(stderr, " %10.1f MB/s", static_cast<double>(result.bytes) / result.seconds / (1024 * 1024));
+            fprintf(stderr, "\n");
+            return record;
+        }
+
+        static run_result run_once(const bench_entry &entry, int64_t arg, size_t threads, uint64_t iterations) {
+            barrier start_barrier(threads);
+            std::vector<state> states;
+            states.reserve(threads);
+            for (size_t i = 0; i < threads; i++)
+                states.emplace_back(iterations, arg, threads, i, &start_barrier);
+            std::vector<std::thread> workers;
+            for (size_t i = 1; i < threads; i++)
+                workers.emplace_back([&entry, &states, i]() { entry.func_(states[i]); });
+            entry.func_(states[0]);
+            for (auto &worker : workers)
+                worker.join();
+
+            run_result result;
+            result.iterations = iterations;
+            for (const auto &s : states) {
+                result.seconds += std::chrono::duration<double>(s.elapsed()).count();
+                result.items += s.items_processed();
+                result.bytes += s.bytes_processed();
+            }
+            result.seconds /= static_cast<double>(threads);
+            return result;
+        }
+
+        static void usage() {
+            fprintf(stderr, "usage : [--filter=substr] [--min-time=ms] [--label=str] [--out=file] [--list]\n");
+            exit(-1);
+        }
+
+    private:
+        static constexpr uint64_t max_iterations = 1000000000;
+
+        std::vector<std::unique_ptr<bench_entry>> entries_;
+        std::string filter_;
+        unsigned int min_time_ms_{200};
+        std::string label_;
+        std::string out_;
+        bool list_only_{false};
+    };
+}
+
+#endif  // SPDNET_BENCH_MICRO_BENCH_H_
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <spdnet/base/spin_lock.h>
+#include <spdnet/net/socket_data.h>
+#include <spdnet/net/loop_metrics.h>
+
+/*
+ * 比较多个线程向同一个session发送时 , 发送队列的入队开销 。
+ * 一个消费线程模拟io线程不断取出全部包 , N个生产线程各发送固定数量的包 ,
+ * flushes是生产者需要投递flush任务的次数 。spin_queue是原先spin_lock + deque的实现 , 作为对照 。
+**/
+
+using spdnet::net::socket_data;
+
+static const char payload[64] = {0};
+
+class spin_queue {
+public:
+    bool push(socket_data::send_packet &&packet) {
+        std::lock_guard<spdnet::base::spin_lock> lck(send_guard_);
+        send_packet_list_.emplace_back(std::move(packet));
+        if (is_post_flush_)
+            return false;
+        is_post_flush_ = true;
+        return true;
+    }
+
+    size_t drain() {
+        is_post_flush_ = false;
+        {
+            std::lock_guard<spdnet::base::spin_lock> lck(send_guard_);
+            pending_packet_list_.swap(send_packet_list_);
+        }
+        size_t count = pending_packet_list_.size();
+        pending_packet_list_.clear();
+        return count;
+    }
+
+private:
+    spdnet::base::spin_lock send_guard_;
+    std::deque<socket_data::send_packet> send_packet_list_;
+    std::deque<socket_data::send_packet> pending_packet_list_;
+    volatile bool is_post_flush_{false};
+};
+
+// 代替io后端提供本轮的唤醒时间和统计
+struct fake_impl {
+    std::chrono::steady_clock::time_point last_wakeup_time() const {
+        return std::chrono::steady_clock::time_point();
+    }
+
+    spdnet::net::loop_metrics &metrics() {
+        return metrics_;
+    }
+
+    spdnet::net::loop_metrics metrics_;
+};
+
+class mpsc_queue {
+public:
+    mpsc_queue() : data_(-1, false) {}
+
+    bool push(socket_data::send_packet &&packet) {
+        auto node = new socket_data::send_packet_node(std::move(packet));
+        return data_.push_send_packets(node, node);
+    }
+
+    size_t drain() {
+        data_.clear_flush_scheduled();
+        data_.merge_send_packets(impl_);
+        size_t count = data_.pending_packet_list_.size();
+        data_.pending_packet_list_.clear();
+        return count;
+    }
+
+private:
+    socket_data data_;
+    fake_impl impl_;
+};
+
+template<typename Queue>
+void run_case(const char *name, int producer_num, long long total_packets) {
+    Queue queue;
+    long long per_producer = total_packets / producer_num;
+    long long expected = per_producer * producer_num;
+    std::atomic_llong flushes{0};
+    std::atomic_bool start{false};
+
+    std::thread consumer([&]() {
+        long long drained = 0;
+        while (drained < expected)
+            drained += static_cast<long long>(queue.drain());
+    });
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < producer_num; i++) {
+        producers.emplace_back([&]() {
+            while (!start)
+                std::this_thread::yield();
+            long long local_flushes = 0;
+            for (long long n = 0; n < per_producer; n++) {
+                if (queue.push(socket_data::send_packet(nullptr, payload, sizeof(payload), nullptr)))
+                    local_flushes++;
+            }
+            flushes.fetch_add(local_flushes, std::memory_order_relaxed);
+        });
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto &t : producers)
+        t.join();
+    auto push_end = std::chrono::steady_clock::now();
+    consumer.join();
+    auto end = std::chrono::steady_clock::now();
+
+    double push_sec = std::chrono::duration<double>(push_end - begin).count();
+    double total_sec = std::chrono::duration<double>(end - begin).count();
+    fprintf(stdout, "%-6s producers:%-3d packets:%-9lld push:%8.1f ns/packet  drain:%8.3f Mpacket/s  flushes:%lld\n",
+            name, producer_num, expected, push_sec * 1e9 / static_cast<double>(expected),
+            static_cast<double>(expected) / total_sec / 1e6, flushes.load());
+}
+
+int main(int argc, char *argv[]) {
+    long long total_packets = 2000000;
+    if (argc > 1)
+        total_packets = atoll(argv[1]);
+    if (total_packets <= 0) {
+        fprintf(stderr, "usage : [total packets]\n");
+        exit(-1);
+    }
+
+    for (int producer_num : {1, 4, 16, 32, 64}) {
+        run_case<spin_queue>("spin", producer_num, total_packets);
+        run_case<mpsc_queue>("mpsc", producer_num, total_packets);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <spdnet/net/task_executor.h>
+
+/*
+ * 比较不同投递线程数下task_executor的跨线程投递开销 。
+ * 一个消费线程循环调用run() , N个生产线程各投递固定数量的task , 统计全部执行完的耗时 。
+ * mutex_executor是原先mutex + vector交换的实现 , 作为对照 。
+**/
+
+class null_wakeup : public spdnet::net::wakeup_base {
+public:
+    void wakeup() override {
+        wakeup_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic_llong wakeup_count_{0};
+};
+
+class mutex_executor {
+public:
+    explicit mutex_executor(spdnet::net::wakeup_base *wakeup) : wakeup_(wakeup) {}
+
+    void post(spdnet::net::task_functor &&task) {
+        {
+            std::lock_guard<std::mutex> lck(task_mutex_);
+            async_tasks_.emplace_back(std::move(task));
+        }
+        wakeup_->wakeup();
+    }
+
+    void run() {
+        {
+            std::lock_guard<std::mutex> lck(task_mutex_);
+            tmp_async_tasks_.swap(async_tasks_);
+        }
+        for (auto &task : tmp_async_tasks_)
+            task();
+        tmp_async_tasks_.clear();
+    }
+
+    void set_thread_id(thread_id_t) {}
+
+private:
+    std::mutex task_mutex_;
+    std::vector<spdnet::net::task_functor> async_tasks_;
+    std::vector<spdnet::net::task_functor> tmp_async_tasks_;
+    spdnet::net::wakeup_base *wakeup_;
+};
+
+template<typename Executor>
+void run_case(const char *name, int producer_num, long long total_tasks) {
+    null_wakeup wakeup;
+    Executor executor(&wakeup);
+    long long per_producer = total_tasks / producer_num;
+    long long expected = per_producer * producer_num;
+    long long executed = 0;
+    std::atomic_bool consumer_ready{false};
+    std::atomic_bool start{false};
+
+    auto begin = std::chrono::steady_clock::now();
+    std::thread consumer([&]() {
+        executor.set_thread_id(spdnet::net::current_thread::tid());
+        consumer_ready = true;
+        while (executed < expected)
+            executor.run();
+    });
+    while (!consumer_ready)
+        std::this_thread::yield();
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < producer_num; i++) {
+        producers.emplace_back([&]() {
+            while (!start)
+                std::this_thread::yield();
+            for (long long n = 0; n < per_producer; n++)
+                executor.post([&executed]() { executed++; });
+        });
+    }
+    begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto &t : producers)
+        t.join();
+    auto post_end = std::chrono::steady_clock::now();
+    consumer.join();
+    auto end = std::chrono::steady_clock::now();
+
+    double post_sec = std::chrono::duration<double>(post_end - begin).count();
+    double total_sec = std::chrono::duration<double>(end - begin).count();
+    fprintf(stdout, "%-8s producers:%-3d tasks:%-9lld post:%8.1f ns/task  drain:%8.3f Mtask/s  wakeups:%lld\n",
+            name, producer_num, expected, post_sec * 1e9 / static_cast<double>(expected),
+            static_cast<double>(expected) / total_sec / 1e6, wakeup.wakeup_count_.load());
+}
+
+int main(int argc, char *argv[]) {
+    long long total_tasks = 2000000;
+    if (argc > 1)
+        total_tasks = atoll(argv[1]);
+    if (total_tasks <= 0) {
+        fprintf(stderr, "usage : [total tasks]\n");
+        exit(-1);
+    }
+
+    for (int producer_num : {1, 4, 16, 64}) {
+        run_case<mutex_executor>("mutex", producer_num, total_tasks);
+        run_case<spdnet::net::task_executor>("mpsc", producer_num, total_tasks);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <spdnet/net/task_executor.h>
+
+/*
+ * 统计每次投递task的堆分配次数 。
+ * 分别用std::function和unique_function包装与库内投递形状相同的lambda ,
+ * 再分别经过task_executor的io线程内投递和跨线程投递(含队列节点)路径统计一次 。
+ * 单独的functor只反映内部存储的效果 ; 跨线程路径的结果同时取决于队列节点是否复用 。
+**/
+
+static std::atomic_llong alloc_count{0};
+
+void *operator new(size_t size) {
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+class null_wakeup : public spdnet::net::wakeup_base {
+public:
+    void wakeup() override {}
+};
+
+struct fake_session {
+    char data[128];
+};
+
+constexpr long long rounds = 1000000;
+
+template<typename Functor, typename Maker>
+void run_functor_case(const char *type_name, const char *case_name, Maker &&maker) {
+    long long executed = 0;
+    long long begin_count = alloc_count.load();
+    auto begin = std::chrono::steady_clock::now();
+    for (long long i = 0; i < rounds; i++) {
+        Functor f(maker(executed));
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double allocs = static_cast<double>(alloc_count.load() - begin_count) / rounds;
+    fprintf(stdout, "%-16s %-26s allocs/post:%5.2f  %6.1f ns/post\n", type_name, case_name, allocs,
+            std::chrono::duration<double>(end - begin).count() * 1e9 / rounds);
+}
+
+template<typename Maker>
+void run_executor_case(const char *type_name, const char *case_name, bool is_in_io_thread, Maker &&maker) {
+    null_wakeup wakeup;
+    spdnet::net::task_executor executor(&wakeup);
+    // 未设置io线程id时post走跨线程的队列路径 , 否则走io线程内的延迟执行路径
+    if (is_in_io_thread)
+        executor.set_thread_id(spdnet::net::current_thread::tid());
+    long long executed = 0;
+    long long begin_count = alloc_count.load();
+    auto begin = std::chrono::steady_clock::now();
+    for (long long i = 0; i < rounds; i++) {
+        executor.post(maker(executed), false);
+        if ((i & 1023) == 1023)
+            executor.run();
+    }
+    executor.run();
+    auto end = std::chrono::steady_clock::now();
+    double allocs = static_cast<double>(alloc_count.load() - begin_count) / rounds;
+    fprintf(stdout, "%-16s %-26s allocs/post:%5.2f  %6.1f ns/post\n", type_name, case_name, allocs,
+            std::chrono::duration<double>(end - begin).count() * 1e9 / rounds);
+}
+
+int main() {
+    auto session = std::make_shared<fake_session>();
+    auto thread = std::make_shared<fake_session>();
+    std::function<void(std::shared_ptr<fake_session>)> enter_callback = [](std::shared_ptr<fake_session>) {};
+
+    // 与epoll_impl::post_flush相同 : 捕获一个裸指针
+    auto raw_ptr = [&session](long long &executed) {
+        fake_session *p = session.get();
+        return [p, &executed]() { executed += p != nullptr; };
+    };
+    // 与tcp_session::post_shutdown相同 : 捕获一个shared_ptr
+    auto one_shared = [&session](long long &executed) {
+        auto p = session;
+        return [p, &executed]() { executed += p != nullptr; };
+    };
+    // 与event_service::add_tcp_session相同 : 两个shared_ptr和一个std::function
+    auto session_enter = [&](long long &executed) {
+        auto t = thread;
+        auto s = session;
+        auto cb = enter_callback;
+        return [t, s, cb]() { cb(s); };
+    };
+
+    run_functor_case<std::function<void()>>("std::function", "post_flush(raw ptr)", raw_ptr);
+    run_functor_case<spdnet::net::task_functor>("unique_function", "post_flush(raw ptr)", raw_ptr);
+    run_functor_case<std::function<void()>>("std::function", "post_shutdown(shared_ptr)", one_shared);
+    run_functor_case<spdnet::net::task_functor>("unique_function", "post_shutdown(shared_ptr)", one_shared);
+    run_functor_case<std::function<void()>>("std::function", "add_tcp_session", session_enter);
+    run_functor_case<spdnet::net::task_functor>("unique_function", "add_tcp_session", session_enter);
+
+    run_executor_case("executor(io)", "post_flush(raw ptr)", true, raw_ptr);
+    run_executor_case("executor(io)", "post_shutdown(shared_ptr)", true, one_shared);
+    run_executor_case("executor(io)", "add_tcp_session", true, session_enter);
+    run_executor_case("executor(async)", "post_flush(raw ptr)", false, raw_ptr);
+    run_executor_case("executor(async)", "post_shutdown(shared_ptr)", false, one_shared);
+    run_executor_case("executor(async)", "add_tcp_session", false, session_enter);
+    return 0;
+}
@@ -4,12 +4,15 @@
 #include <spdnet/net/connector.h>
 
 int main(int argc, char *argv[]) {
-    if (argc != 6) {
-        fprintf(stderr, "usage: <host> <port> <thread num> <data size> <client num>\n");
+    if (argc != 6 && argc != 7) {
+        fprintf(stderr, "usage: <host> <port> <thread num> <data size> <client num> [epoll|io_uring]\n");
         exit(-1);
     }
     auto send_data = std::make_shared<std::string>(atoi(argv[4]), 'a');
-    spdnet::net::event_service service;
+    auto backend = spdnet::net::default_io_backend;
+    if (argc == 7 && std::string(argv[6]) == "io_uring")
+        backend = spdnet::net::io_backend::io_uring;
+    spdnet::net::event_service service(backend);
     service.run_thread(atoi(argv[3]));
 
     spdnet::net::async_connector connector(service);
@@ -25,12 +25,15 @@ void gprofStartAndStop(int signum) {
 }
 */
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "usage : <port> <thread num>\n");
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "usage : <port> <thread num> [epoll|io_uring]\n");
         exit(-1);
     }
     ///signal(SIGUSR1, gprofStartAndStop);
-    spdnet::net::event_service service;
+    auto backend = spdnet::net::default_io_backend;
+    if (argc == 4 && std::string(argv[3]) == "io_uring")
+        backend = spdnet::net::io_backend::io_uring;
+    spdnet::net::event_service service(backend);
     service.run_thread(atoi(argv[2]));
     spdnet::net::tcp_acceptor acceptor(service);
     acceptor.start(spdnet::net::end_point::ipv4("0.0.0.0", atoi(argv[1])),
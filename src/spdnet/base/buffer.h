@@ -2,19 +2,33 @@
 #define SPDNET_BASE_BUFFER_H
 
 #include <memory>
+#include <cstdlib>
 #include <cstring>
+#include <new>
 
 namespace spdnet {
     namespace base {
+        class buffer;
+
+        // buffer内存的另一种来源(如大页内存池) , 不设置时用malloc/free
+        class buffer_storage {
+        public:
+            // buffer析构或grow换用malloc时交还内存
+            virtual void deallocate(char *data, size_t size) = 0;
+
+            // 回收整个buffer , 头部和内存一起留给storage复用
+            virtual void recycle(buffer *buf) = 0;
+
+        protected:
+            ~buffer_storage() = default;
+        };
+
         class buffer {
         public:
             static constexpr size_t min_buffer_size = 1024;
 
             ~buffer() {
-                if (data_ != nullptr) {
-                    free(data_);
-                    data_ = nullptr;
-                }
+                release_data();
             }
 
             explicit buffer(size_t buffer_size = min_buffer_size) {
@@ -24,6 +38,22 @@ namespace spdnet {
                     data_size_ = buffer_size;
             }
 
+            // 使用storage分配好的内存 , 析构时交还给storage
+            buffer(char *data, size_t size, buffer_storage *storage)
+                    : data_(data), data_size_(size), storage_(storage) {
+            }
+
+            buffer_storage *get_storage() const {
+                return storage_;
+            }
+
+            // storage自身销毁时丢弃内存而不交还 , 之后可以直接delete
+            void detach_storage() {
+                data_ = nullptr;
+                data_size_ = 0;
+                storage_ = nullptr;
+            }
+
             void write(const char *data, size_t len) {
                 if (get_write_valid_count() >= len) {
                     memcpy(get_write_ptr(), data, len);
@@ -34,7 +64,10 @@ namespace spdnet {
                         adjust_to_head();
                         write(data, len);
                     } else {
+                        // 至少扩大一倍 , 连续追加时均摊O(n)
                         size_t need_len = len - left_len;
+                        if (need_len < data_size_)
+                            need_len = data_size_;
                         if (need_len > 0) {
                             grow(need_len);
                             write(data, len);
@@ -64,19 +97,31 @@ namespace spdnet {
                 std::swap(data_size_, other.data_size_);
                 std::swap(write_pos_, other.write_pos_);
                 std::swap(read_pos_, other.read_pos_);
+                std::swap(storage_, other.storage_);
             }
 
             void clear() {
                 init();
             }
 
+            // 内存来自malloc , 扩容同样用realloc , 不能混用new[]/delete[]
             void grow(size_t len) {
                 size_t n = data_size_ + len;
-                char *new_data = new char[n];
-                memcpy(new_data, data_, write_pos_);
-                data_size_ = n;
-                delete[] data_;
+                char *new_data = nullptr;
+                if (storage_ != nullptr) {
+                    // storage的内存大小固定 , 扩容后改用malloc的内存
+                    new_data = (char *) malloc(sizeof(char) * n);
+                    if (new_data != nullptr) {
+                        memcpy(new_data, data_, write_pos_);
+                        release_data();
+                    }
+                } else {
+                    new_data = (char *) realloc(data_, sizeof(char) * n);
+                }
+                if (new_data == nullptr)
+                    throw std::bad_alloc();
                 data_ = new_data;
+                data_size_ = n;
             }
 
             void adjust_to_head() {
@@ -127,6 +172,17 @@ namespace spdnet {
                 write_pos_ = 0;
             }
 
+            void release_data() {
+                if (data_ != nullptr) {
+                    if (storage_ != nullptr)
+                        storage_->deallocate(data_, data_size_);
+                    else
+                        free(data_);
+                    data_ = nullptr;
+                }
+                storage_ = nullptr;
+            }
+
             char *data_{nullptr};
             size_t data_size_{0};
 
@@ -134,6 +190,7 @@ namespace spdnet {
             size_t read_pos_{0};
 
             buffer *next_{nullptr};
+            buffer_storage *storage_{nullptr};
         };
 
     }
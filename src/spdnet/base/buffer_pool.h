@@ -4,68 +4,270 @@
 #include <memory>
 #include <cstring>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cassert>
 #include <limits>
+#include <algorithm>
+#include <spdnet/base/platform.h>
 #include <spdnet/base/buffer.h>
-#include <spdnet/base/singleton.h>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/stat_counter.h>
 
 namespace spdnet {
     namespace base {
+        /*
+         * 进程内共享的buffer池 , 按容量分成多个大小级别 。
+         * 每个线程为每个级别缓存少量buffer(线程本地 , 无原子操作) , 满了或空了才整批(magazine)
+         * 和全局仓库交换 。仓库容量固定 , 放不下的直接释放 ; 仓库的栈用带版本号的下标做CAS , 没有ABA问题 。
+         * io线程定期调用trim_thread_cache和trim_depot , 把一段时间内没用到的缓存还给系统 。
+        **/
         class buffer_pool : public spdnet::base::noncopyable {
         public:
             static constexpr size_t max_pool_size = 32;
+            // 只缓存容量不超过min_buffer_size << max_cached_index(1MB)的buffer , 更大的直接申请和释放
+            static constexpr size_t max_cached_index = 10;
+            static constexpr size_t max_magazine_size = 16;
+            // 每个线程每个级别大约缓存的字节数 , 决定magazine的大小
+            static constexpr size_t magazine_bytes = 256 * 1024;
+            static constexpr size_t depot_magazines = 32;
 
-            buffer_pool() {
-                for (size_t i = 0; i < max_pool_size; i++) {
-                    pool_[i] = nullptr;
-                }
+            // 一个线程的分配统计 : 命中本线程缓存或全局仓库 , 以及需要向系统申请
+            struct alloc_stats {
+                stat_counter hits_;
+                stat_counter misses_;
+            };
+
+            // 登记后本线程的分配计入stats , 传nullptr取消 ; stats需在线程退出或取消前一直有效
+            static void set_thread_stats(alloc_stats *stats) {
+                local_cache().stats_ = stats;
             }
 
-            ~buffer_pool() {
-                for (size_t i = 0; i < max_pool_size; i++) {
-                    buffer *ptr = pool_[i].load(std::memory_order_relaxed);
-                    while (ptr) {
-                        buffer *next = ptr->get_next();
-                        delete ptr;
-                        ptr = next;
-                    }
-                    pool_[i] = nullptr;
-                }
+            // 永不析构 , 线程退出时归还缓存不必担心析构顺序
+            static buffer_pool &instance() {
+                static buffer_pool *pool = new buffer_pool();
+                return *pool;
             }
 
             void recycle_buffer(buffer *buf) {
                 assert(buf != nullptr);
-                uint32_t index = get_index(buf->get_capacity());
-                auto &pool_head = pool_[index];
-                buffer *ptr = nullptr;
-                do {
-                    ptr = pool_head.load(std::memory_order_relaxed);
-                    buf->set_next(ptr);
-                } while (!pool_head.compare_exchange_weak(
-                        ptr, buf, std::memory_order_release, std::memory_order_relaxed));
+                buf->clear();
+                buf->set_next(nullptr);
+                // 其它来源的buffer交还给各自的storage
+                if (SPDNET_PREDICT_FALSE(buf->get_storage() != nullptr)) {
+                    buf->get_storage()->recycle(buf);
+                    return;
+                }
+                size_t index = get_floor_index(buf->get_capacity());
+                if (SPDNET_PREDICT_FALSE(index > max_cached_index)) {
+                    delete buf;
+                    return;
+                }
+                auto &bin = local_cache().bins_[index];
+                if (SPDNET_PREDICT_FALSE(bin.count_ == 2 * magazine_size(index)))
+                    spill(index, bin);
+                bin.items_[bin.count_++] = buf;
             }
 
+            // 返回的buffer容量不小于size
             buffer *alloc_buffer(size_t size) {
                 size_t index = get_index(size);
-                assert(index < pool_.size());
-                auto &pool_head = pool_[index];
-                /*
-                buffer *buffer = pool_head.load(std::memory_order_acquire);
-                if (SPDNET_PREDICT_FALSE(!buffer)) {
+                assert(index < max_pool_size);
+                auto &cache = local_cache();
+                if (SPDNET_PREDICT_FALSE(index > max_cached_index)) {
+                    count_alloc(cache, false);
                     return new buffer(size);
                 }
-                */
-                buffer *ptr = nullptr;
-                do {
-                    ptr = pool_head.load(std::memory_order_relaxed);
-                } while (ptr && !pool_head.compare_exchange_weak(
-                        ptr, ptr->get_next(), std::memory_order_release, std::memory_order_relaxed));
-                if (!ptr)
-                    ptr = new buffer(size);
-                return ptr;
+                auto &bin = cache.bins_[index];
+                if (SPDNET_PREDICT_FALSE(bin.count_ == 0)) {
+                    if (!refill(index, bin)) {
+                        count_alloc(cache, false);
+                        return new buffer(class_size(index));
+                    }
+                }
+                buffer *buf = bin.items_[--bin.count_];
+                if (bin.count_ < bin.low_water_)
+                    bin.low_water_ = bin.count_;
+                count_alloc(cache, true);
+                return buf;
+            }
+
+            // 释放本线程缓存里自上次调用以来一直没用到的部分 , 由每个io线程定期调用
+            void trim_thread_cache() {
+                auto &cache = local_cache();
+                for (size_t index = 0; index <= max_cached_index; index++) {
+                    auto &bin = cache.bins_[index];
+                    for (size_t i = 0; i < bin.low_water_; i++)
+                        delete bin.items_[--bin.count_];
+                    bin.low_water_ = bin.count_;
+                }
+            }
+
+            /*
+             * 仓库里某个级别在一个周期内没有被取用过 , 释放其中一半的magazine 。
+             * 仓库是全局的 , 每个io线程都会调用 , 但每个周期只有第一个调用者执行 ;
+             * 否则N个线程在一个周期内会把仓库减半N次 , 刚被取用过的级别也很快被清空 。
+            **/
+            void trim_depot(std::chrono::steady_clock::time_point now, std::chrono::milliseconds interval) {
+                int64_t now_tick = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now.time_since_epoch()).count();
+                int64_t next_tick = next_depot_trim_tick_.load(std::memory_order_relaxed);
+                if (now_tick < next_tick || !next_depot_trim_tick_.compare_exchange_strong(
+                        next_tick, now_tick + interval.count(), std::memory_order_relaxed))
+                    return;
+
+                for (size_t index = 0; index <= max_cached_index; index++) {
+                    auto &depot = depots_[index];
+                    uint32_t refills = depot.refill_count_.load(std::memory_order_relaxed);
+                    if (depot.trimmed_refill_count_.exchange(refills, std::memory_order_relaxed) != refills)
+                        continue;
+                    uint32_t release_count = (depot.full_count_.load(std::memory_order_relaxed) + 1) / 2;
+                    uint32_t slot_index = 0;
+                    while (release_count-- > 0 && pop_slot(depot.full_head_, depot, slot_index)) {
+                        depot.full_count_.fetch_sub(1, std::memory_order_relaxed);
+                        auto &slot = depot.slots_[slot_index];
+                        for (size_t i = 0; i < slot.count_; i++)
+                            delete slot.items_[i];
+                        slot.count_ = 0;
+                        push_slot(depot.free_head_, depot, slot_index);
+                    }
+                }
             }
 
         private:
+            struct depot_slot {
+                std::atomic<uint32_t> next_{0};
+                size_t count_{0};
+                buffer *items_[max_magazine_size];
+            };
+
+            // 栈顶是(版本号 << 32) | (下标 + 1) , 0表示空栈
+            struct depot {
+                std::atomic<uint64_t> full_head_{0};
+                std::atomic<uint64_t> free_head_{0};
+                std::atomic<uint32_t> full_count_{0};
+                std::atomic<uint32_t> refill_count_{0};
+                std::atomic<uint32_t> trimmed_refill_count_{0};
+                std::array<depot_slot, depot_magazines> slots_;
+            };
+
+            struct thread_cache : public spdnet::base::noncopyable {
+                struct bin {
+                    buffer *items_[2 * max_magazine_size];
+                    size_t count_{0};
+                    // 自上次trim以来的最少数量 , 这部分缓存一直没用到
+                    size_t low_water_{0};
+                };
+
+                ~thread_cache() {
+                    auto &pool = buffer_pool::instance();
+                    for (size_t index = 0; index <= max_cached_index; index++) {
+                        while (bins_[index].count_ > 0)
+                            pool.spill(index, bins_[index]);
+                    }
+                }
+
+                bin bins_[max_cached_index + 1];
+                alloc_stats *stats_{nullptr};
+            };
+
+            static void count_alloc(thread_cache &cache, bool hit) {
+                if (cache.stats_ == nullptr)
+                    return;
+                if (hit)
+                    cache.stats_->hits_.add();
+                else
+                    cache.stats_->misses_.add();
+            }
+
+            buffer_pool() {
+                for (auto &depot : depots_) {
+                    for (uint32_t i = 0; i < depot_magazines; i++)
+                        push_slot(depot.free_head_, depot, i);
+                }
+            }
+
+            static thread_cache &local_cache() {
+                static thread_local thread_cache cache;
+                return cache;
+            }
+
+            static size_t class_size(size_t index) {
+                return buffer::min_buffer_size << index;
+            }
+
+            static size_t magazine_size(size_t index) {
+                size_t count = magazine_bytes / class_size(index);
+                if (count > max_magazine_size)
+                    return max_magazine_size;
+                return count > 0 ? count : 1;
+            }
+
+            // 本线程缓存满了 , 把最早放入的一个magazine交给仓库 , 仓库也满了就直接释放
+            void spill(size_t index, thread_cache::bin &bin) {
+                size_t count = (std::min)(bin.count_, magazine_size(index));
+                auto &depot = depots_[index];
+                uint32_t slot_index = 0;
+                if (pop_slot(depot.free_head_, depot, slot_index)) {
+                    auto &slot = depot.slots_[slot_index];
+                    std::copy(bin.items_, bin.items_ + count, slot.items_);
+                    slot.count_ = count;
+                    push_slot(depot.full_head_, depot, slot_index);
+                    depot.full_count_.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    for (size_t i = 0; i < count; i++)
+                        delete bin.items_[i];
+                }
+                std::copy(bin.items_ + count, bin.items_ + bin.count_, bin.items_);
+                bin.count_ -= count;
+                bin.low_water_ = (std::min)(bin.low_water_, bin.count_);
+            }
+
+            // 本线程缓存空了 , 从仓库取一个magazine
+            bool refill(size_t index, thread_cache::bin &bin) {
+                auto &depot = depots_[index];
+                uint32_t slot_index = 0;
+                if (!pop_slot(depot.full_head_, depot, slot_index))
+                    return false;
+                depot.full_count_.fetch_sub(1, std::memory_order_relaxed);
+                depot.refill_count_.fetch_add(1, std::memory_order_relaxed);
+                auto &slot = depot.slots_[slot_index];
+                std::copy(slot.items_, slot.items_ + slot.count_, bin.items_);
+                bin.count_ = slot.count_;
+                slot.count_ = 0;
+                push_slot(depot.free_head_, depot, slot_index);
+                return bin.count_ > 0;
+            }
+
+            static bool pop_slot(std::atomic<uint64_t> &head, depot &depot, uint32_t &slot_index) {
+                uint64_t old_head = head.load(std::memory_order_acquire);
+                while (true) {
+                    uint32_t top = static_cast<uint32_t>(old_head);
+                    if (top == 0)
+                        return false;
+                    // 读到的next可能已经过时 , 但那时栈顶的版本号一定变了 , CAS会失败
+                    uint32_t next = depot.slots_[top - 1].next_.load(std::memory_order_relaxed);
+                    uint64_t new_head = (((old_head >> 32) + 1) << 32) | next;
+                    if (head.compare_exchange_weak(old_head, new_head, std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+                        slot_index = top - 1;
+                        return true;
+                    }
+                }
+            }
+
+            static void push_slot(std::atomic<uint64_t> &head, depot &depot, uint32_t slot_index) {
+                uint64_t old_head = head.load(std::memory_order_relaxed);
+                uint64_t new_head;
+                do {
+                    depot.slots_[slot_index].next_.store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+                    new_head = (((old_head >> 32) + 1) << 32) | (slot_index + 1);
+                } while (!head.compare_exchange_weak(old_head, new_head, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+            }
+
+            // 容量至少为size的级别
             static size_t get_index(size_t size) {
                 size_t index = 0;
                 if (SPDNET_PREDICT_FALSE(size > buffer::min_buffer_size)) {
@@ -80,8 +282,18 @@ namespace spdnet {
                 return index;
             }
 
+            // 容量能满足的最大级别 , 保证从该级别取出的buffer不小于级别大小
+            static size_t get_floor_index(size_t capacity) {
+                size_t index = 0;
+                while (index + 1 < max_pool_size && class_size(index + 1) <= capacity)
+                    index++;
+                return index;
+            }
+
         private:
-            std::array<std::atomic<buffer *>, max_pool_size> pool_;
+            std::array<depot, max_cached_index + 1> depots_;
+            // steady_clock毫秒数 , 在此之前不再整理仓库
+            std::atomic<int64_t> next_depot_trim_tick_{0};
         };
 
     }
@@ -0,0 +1,186 @@
+#ifndef SPDNET_BASE_CHAIN_BUFFER_H
+#define SPDNET_BASE_CHAIN_BUFFER_H
+
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/buffer.h>
+
+namespace spdnet {
+    namespace base {
+        /*
+         * 由多个块串成的接收缓冲区 。数据直接读入各个块 , 增长时只追加新块 ,
+         * 不会整体拷贝或memmove ; 需要连续内存时由linearize按需合并 。
+         * 块通过Allocator的alloc_buffer/recycle_buffer从buffer_pool分配和回收 , 只能在io线程里使用 。
+        **/
+        class chain_buffer : public spdnet::base::noncopyable {
+        public:
+            static constexpr size_t block_size = 16 * 1024;
+
+            chain_buffer() = default;
+
+            ~chain_buffer() {
+                while (head_ != nullptr) {
+                    buffer *next = head_->get_next();
+                    delete head_;
+                    head_ = next;
+                }
+            }
+
+            size_t get_length() const {
+                return length_;
+            }
+
+            bool empty() const {
+                return length_ == 0;
+            }
+
+            // 第一个块里的数据 , 不一定是全部数据
+            char *front_data() {
+                return head_ != nullptr ? head_->get_data_ptr() : nullptr;
+            }
+
+            size_t front_length() const {
+                return head_ != nullptr ? head_->get_length() : 0;
+            }
+
+            /*
+             * 准备至少len字节的可写空间 , 以func(ptr, len)依次给出各段 , 最多max_count段 , 返回段数 。
+             * 先用当前写入块剩余的空间 , 不够时在末尾追加新块 ; 写入后调用commit 。
+            **/
+            template<typename Allocator, typename Func>
+            size_t prepare(Allocator &alloc, size_t len, size_t max_count, Func &&func) {
+                size_t count = 0;
+                size_t prepared = 0;
+                buffer *block = write_block_;
+                while (count < max_count && prepared < len) {
+                    if (block == nullptr) {
+                        block = append_block(alloc);
+                        if (write_block_ == nullptr)
+                            write_block_ = block;
+                    }
+                    size_t valid_count = block->get_write_valid_count();
+                    if (valid_count > 0) {
+                        func(block->get_write_ptr(), valid_count);
+                        prepared += valid_count;
+                        count++;
+                    }
+                    block = block->get_next();
+                }
+                return count;
+            }
+
+            // 确认prepare给出的空间里写入了len字节
+            void commit(size_t len) {
+                length_ += len;
+                while (len > 0) {
+                    assert(write_block_ != nullptr);
+                    size_t n = (std::min)(len, write_block_->get_write_valid_count());
+                    write_block_->add_write_pos(n);
+                    len -= n;
+                    if (write_block_->get_write_valid_count() == 0 && write_block_->get_next() != nullptr)
+                        write_block_ = write_block_->get_next();
+                }
+            }
+
+            // 从头部移除len字节 , 读完的块回收到Allocator
+            template<typename Allocator>
+            void remove_length(Allocator &alloc, size_t len) {
+                assert(len <= length_);
+                length_ -= len;
+                while (len > 0) {
+                    size_t n = (std::min)(len, head_->get_length());
+                    head_->remove_length(n);
+                    len -= n;
+                    if (head_->get_length() == 0 && head_ != write_block_)
+                        recycle_front(alloc);
+                }
+                // 数据全部取走后当前块从头开始写
+                if (length_ == 0 && head_ != nullptr && head_ == write_block_)
+                    head_->clear();
+            }
+
+            /*
+             * 返回全部数据的连续视图 。数据跨越多个块时合并到一个新块 ,
+             * 新块预留与已有数据同样大的空间 , 之后的数据先写进这里 , 持续累积大消息时拷贝总量是线性的 。
+            **/
+            template<typename Allocator>
+            char *linearize(Allocator &alloc) {
+                if (head_ == nullptr || head_->get_length() == length_)
+                    return front_data();
+
+                buffer *merged = alloc.alloc_buffer(length_ * 2);
+                buffer *rest = write_block_->get_next();
+                while (head_ != rest) {
+                    if (head_->get_length() > 0)
+                        merged->write(head_->get_data_ptr(), head_->get_length());
+                    recycle_front(alloc);
+                }
+                merged->set_next(rest);
+                head_ = merged;
+                write_block_ = merged;
+                if (rest == nullptr)
+                    tail_ = merged;
+                return merged->get_data_ptr();
+            }
+
+            // 回收写入块之后没用上的空块 ; 数据全部取走时只保留一个标准大小的块供下次读取
+            template<typename Allocator>
+            void shrink(Allocator &alloc) {
+                if (write_block_ == nullptr)
+                    return;
+                buffer *block = write_block_->get_next();
+                write_block_->set_next(nullptr);
+                tail_ = write_block_;
+                while (block != nullptr) {
+                    buffer *next = block->get_next();
+                    recycle_block(alloc, block);
+                    block = next;
+                }
+                if (length_ == 0 && head_->get_capacity() > block_size) {
+                    recycle_block(alloc, head_);
+                    head_ = tail_ = write_block_ = nullptr;
+                }
+            }
+
+        private:
+            template<typename Allocator>
+            buffer *append_block(Allocator &alloc) {
+                buffer *block = alloc.alloc_buffer(block_size);
+                block->set_next(nullptr);
+                if (tail_ != nullptr)
+                    tail_->set_next(block);
+                else
+                    head_ = block;
+                tail_ = block;
+                return block;
+            }
+
+            template<typename Allocator>
+            void recycle_front(Allocator &alloc) {
+                buffer *block = head_;
+                head_ = block->get_next();
+                if (head_ == nullptr)
+                    tail_ = nullptr;
+                recycle_block(alloc, block);
+            }
+
+            template<typename Allocator>
+            static void recycle_block(Allocator &alloc, buffer *block) {
+                block->clear();
+                block->set_next(nullptr);
+                alloc.recycle_buffer(block);
+            }
+
+        private:
+            buffer *head_{nullptr};
+            buffer *tail_{nullptr};
+            // 数据末尾所在的块 , 它之后的块都是空的
+            buffer *write_block_{nullptr};
+            size_t length_{0};
+        };
+    }
+}
+
+#endif //SPDNET_BASE_CHAIN_BUFFER_H
@@ -0,0 +1,249 @@
+#ifndef SPDNET_BASE_HUGEPAGE_ARENA_H
+#define SPDNET_BASE_HUGEPAGE_ARENA_H
+
+#include <spdnet/base/platform.h>
+
+#if defined(SPDNET_PLATFORM_LINUX)
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <sys/mman.h>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/buffer.h>
+#include <spdnet/base/numa.h>
+
+namespace spdnet {
+    namespace base {
+        /*
+         * 从大块mmap内存里切分buffer的slab分配器 , 每个service_thread一个 。
+         * 内存按2MB对齐并设置MADV_HUGEPAGE(或直接用hugetlbfs的MAP_HUGETLB) ,
+         * 大量小buffer集中在少数大页里 , 减少do_recv和flush_buffer的dTLB miss 。
+         * 回收的buffer连同头部留在各级别的空闲链表里复用 , 不还给系统 ; 超过max_bytes或更大的buffer由调用方改用普通内存 。
+         * 只有绑定的所有者线程从arena分配 , 空闲链表只由它访问 , 不加锁 ; 其它线程释放的buffer无锁压入旁路链表 ,
+         * 所有者的本地链表用完时一次取走 。互斥锁只在映射新区域时使用 。
+         * 每个未释放的buffer持有一个引用 , 所有者release后等最后一个buffer析构时才解除映射 。
+        **/
+        class hugepage_arena final : public buffer_storage, public spdnet::base::noncopyable {
+        public:
+            static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+            static constexpr size_t region_size = 32 * 1024 * 1024;
+            // 1KB到64KB共7个级别
+            static constexpr size_t slab_class_count = 7;
+
+            // numa_node不小于0时映射的内存优先放在该节点上 , 不论由哪个线程首次访问
+            static hugepage_arena *create(size_t max_bytes, bool use_hugetlb, int numa_node = -1) {
+                return new hugepage_arena(max_bytes, use_hugetlb, numa_node);
+            }
+
+            // 在所有者线程里调用 , 传nullptr解除绑定
+            static void set_thread_arena(hugepage_arena *arena) {
+                thread_arena() = arena;
+            }
+
+            // 返回nullptr表示不在所有者线程、大小超出级别或内存已用完
+            buffer *alloc_buffer(size_t size) {
+                if (SPDNET_PREDICT_FALSE(thread_arena() != this))
+                    return nullptr;
+                size_t index = get_index(size);
+                if (index >= slab_class_count)
+                    return nullptr;
+                buffer *buf = buffers_[index];
+                if (SPDNET_PREDICT_FALSE(buf == nullptr))
+                    buf = buffers_[index] = remote_buffers_[index].exchange(nullptr, std::memory_order_acquire);
+                if (SPDNET_PREDICT_TRUE(buf != nullptr)) {
+                    buffers_[index] = buf->get_next();
+                    buf->set_next(nullptr);
+                } else {
+                    char *data = allocate(index);
+                    if (data == nullptr)
+                        return nullptr;
+                    buf = new buffer(data, class_size(index), this);
+                }
+                refs_.fetch_add(1, std::memory_order_relaxed);
+                return buf;
+            }
+
+            void recycle(buffer *buf) override {
+                size_t index = get_index(buf->get_capacity());
+                if (thread_arena() == this) {
+                    buf->set_next(buffers_[index]);
+                    buffers_[index] = buf;
+                } else {
+                    auto &head = remote_buffers_[index];
+                    buffer *next = head.load(std::memory_order_relaxed);
+                    do {
+                        buf->set_next(next);
+                    } while (!head.compare_exchange_weak(next, buf, std::memory_order_release,
+                                                         std::memory_order_relaxed));
+                }
+                unref();
+            }
+
+            void deallocate(char *data, size_t size) override {
+                auto block = reinterpret_cast<free_block *>(data);
+                size_t index = get_index(size);
+                if (thread_arena() == this) {
+                    block->next_ = blocks_[index];
+                    blocks_[index] = block;
+                } else {
+                    auto &head = remote_blocks_[index];
+                    free_block *next = head.load(std::memory_order_relaxed);
+                    do {
+                        block->next_ = next;
+                    } while (!head.compare_exchange_weak(next, block, std::memory_order_release,
+                                                         std::memory_order_relaxed));
+                }
+                unref();
+            }
+
+            // 所有者不再分配 , 剩余的buffer全部析构后释放内存
+            void release() {
+                unref();
+            }
+
+            size_t mapped_bytes() const {
+                std::lock_guard<std::mutex> lck(mutex_);
+                return regions_.size() * region_size;
+            }
+
+        private:
+            struct free_block {
+                free_block *next_;
+            };
+
+            hugepage_arena(size_t max_bytes, bool use_hugetlb, int numa_node)
+                    : max_bytes_(max_bytes), use_hugetlb_(use_hugetlb), numa_node_(numa_node) {
+                for (size_t i = 0; i < slab_class_count; i++) {
+                    buffers_[i] = nullptr;
+                    blocks_[i] = nullptr;
+                    remote_buffers_[i].store(nullptr, std::memory_order_relaxed);
+                    remote_blocks_[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+
+            ~hugepage_arena() {
+                // 空闲的buffer头部还指向区域内存 , 先丢弃再释放
+                for (size_t i = 0; i < slab_class_count; i++) {
+                    delete_buffers(buffers_[i]);
+                    delete_buffers(remote_buffers_[i].load(std::memory_order_acquire));
+                }
+                for (auto region : regions_)
+                    ::munmap(region, region_size);
+            }
+
+            static hugepage_arena *&thread_arena() {
+                static thread_local hugepage_arena *arena = nullptr;
+                return arena;
+            }
+
+            static void delete_buffers(buffer *buf) {
+                while (buf != nullptr) {
+                    buffer *next = buf->get_next();
+                    buf->detach_storage();
+                    delete buf;
+                    buf = next;
+                }
+            }
+
+            void unref() {
+                if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    delete this;
+            }
+
+            static size_t class_size(size_t index) {
+                return buffer::min_buffer_size << index;
+            }
+
+            static size_t get_index(size_t size) {
+                size_t index = 0;
+                while (index < slab_class_count && class_size(index) < size)
+                    index++;
+                return index;
+            }
+
+            // 只在所有者线程调用
+            char *allocate(size_t index) {
+                free_block *block = blocks_[index];
+                if (block == nullptr)
+                    block = remote_blocks_[index].exchange(nullptr, std::memory_order_acquire);
+                if (block != nullptr) {
+                    blocks_[index] = block->next_;
+                    return reinterpret_cast<char *>(block);
+                }
+                size_t size = class_size(index);
+                if (region_left_ < size) {
+                    std::lock_guard<std::mutex> lck(mutex_);
+                    // 至少映射一个区域
+                    if (!regions_.empty() && (regions_.size() + 1) * region_size > max_bytes_)
+                        return nullptr;
+                    char *region = map_region();
+                    if (region == nullptr)
+                        return nullptr;
+                    if (numa_node_ >= 0)
+                        spdnet::base::numa::prefer_node(region, region_size, numa_node_);
+                    regions_.push_back(region);
+                    region_pos_ = region;
+                    region_left_ = region_size;
+                }
+                // 顺序切分 , 块前后没有额外的头部
+                char *data = region_pos_;
+                region_pos_ += size;
+                region_left_ -= size;
+                return data;
+            }
+
+            char *map_region() {
+                if (use_hugetlb_) {
+                    void *ptr = ::mmap(nullptr, region_size, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                    if (ptr != MAP_FAILED)
+                        return static_cast<char *>(ptr);
+                    // 没有预留hugetlbfs大页 , 退回透明大页
+                    use_hugetlb_ = false;
+                }
+
+                // 多映射一个大页 , 对齐到2MB后把首尾多余的部分解除映射 , 透明大页只作用于对齐的区间
+                size_t map_size = region_size + huge_page_size;
+                void *ptr = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (ptr == MAP_FAILED)
+                    return nullptr;
+                char *base = static_cast<char *>(ptr);
+                char *aligned = reinterpret_cast<char *>(
+                        (reinterpret_cast<uintptr_t>(base) + huge_page_size - 1) & ~(uintptr_t) (huge_page_size - 1));
+                if (aligned > base)
+                    ::munmap(base, aligned - base);
+                char *end = base + map_size;
+                if (end > aligned + region_size)
+                    ::munmap(aligned + region_size, end - (aligned + region_size));
+#if defined(MADV_HUGEPAGE)
+                ::madvise(aligned, region_size, MADV_HUGEPAGE);
+#endif
+                return aligned;
+            }
+
+        private:
+            // 以下只由所有者线程访问
+            buffer *buffers_[slab_class_count];
+            free_block *blocks_[slab_class_count];
+            char *region_pos_{nullptr};
+            size_t region_left_{0};
+            // 保护区域列表 , 只在映射新区域和查询时使用 ; 顺带把本地链表和旁路链表隔开
+            mutable std::mutex mutex_;
+            std::vector<char *> regions_;
+            size_t max_bytes_;
+            bool use_hugetlb_;
+            int numa_node_;
+            // 其它线程释放的buffer和内存块
+            std::atomic<buffer *> remote_buffers_[slab_class_count];
+            std::atomic<free_block *> remote_blocks_[slab_class_count];
+            // 所有者持有一个引用
+            std::atomic<size_t> refs_{1};
+        };
+    }
+}
+
+#endif // SPDNET_PLATFORM_LINUX
+
+#endif //SPDNET_BASE_HUGEPAGE_ARENA_H
@@ -0,0 +1,131 @@
+#ifndef SPDNET_BASE_LATENCY_HISTOGRAM_H_
+#define SPDNET_BASE_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/stat_counter.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace spdnet {
+    namespace base {
+        /*
+         * 对数-线性分桶的耗时直方图 , 单位ns 。
+         * 小于sub_bucket_count的值每个值一个桶 , 之后每个2的幂区间再等分成sub_bucket_count个桶 , 相对误差不超过1/32 ;
+         * 超过2^max_value_bits的值都落在最后一个桶 。
+        **/
+        struct latency_histogram_layout {
+            static constexpr int sub_bucket_bits = 5;
+            static constexpr uint64_t sub_bucket_count = uint64_t(1) << sub_bucket_bits;
+            // 约36分钟
+            static constexpr int max_value_bits = 41;
+            static constexpr size_t bucket_count = (max_value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+            static size_t bucket_index(uint64_t value) {
+                if (value < sub_bucket_count)
+                    return static_cast<size_t>(value);
+                int msb = highest_bit(value);
+                if (msb >= max_value_bits)
+                    return bucket_count - 1;
+                int shift = msb - sub_bucket_bits;
+                return static_cast<size_t>(shift + 1) * sub_bucket_count
+                       + static_cast<size_t>((value >> shift) & (sub_bucket_count - 1));
+            }
+
+            // 桶内的最大值
+            static uint64_t bucket_upper(size_t index) {
+                if (index < sub_bucket_count)
+                    return index;
+                int shift = static_cast<int>(index / sub_bucket_count) - 1;
+                uint64_t sub = sub_bucket_count + index % sub_bucket_count;
+                return ((sub + 1) << shift) - 1;
+            }
+
+            static int highest_bit(uint64_t value) {
+#if defined(_MSC_VER)
+                unsigned long index;
+                _BitScanReverse64(&index, value);
+                return static_cast<int>(index);
+#else
+                return 63 - __builtin_clzll(value);
+#endif
+            }
+        };
+
+        // 某一时刻的直方图 , 计数是累计值
+        struct latency_histogram_snapshot {
+            std::vector<uint64_t> counts;
+            uint64_t total{0};
+            uint64_t sum_ns{0};
+            uint64_t max_ns{0};
+
+            latency_histogram_snapshot()
+                    : counts(latency_histogram_layout::bucket_count, 0) {}
+
+            double mean_ns() const {
+                return total > 0 ? static_cast<double>(sum_ns) / total : 0.0;
+            }
+
+            // 分位数 , percentile取0~100 , 如99.9 ; 返回所在桶的上界 , 不超过记录到的最大值
+            uint64_t percentile(double percentile) const {
+                if (total == 0)
+                    return 0;
+                uint64_t rank = static_cast<uint64_t>(total * percentile / 100);
+                uint64_t seen = 0;
+                for (size_t i = 0; i < counts.size(); i++) {
+                    seen += counts[i];
+                    if (seen > rank) {
+                        uint64_t upper = latency_histogram_layout::bucket_upper(i);
+                        return upper < max_ns ? upper : max_ns;
+                    }
+                }
+                return max_ns;
+            }
+
+            // 合并另一个线程的直方图
+            void merge(const latency_histogram_snapshot &other) {
+                for (size_t i = 0; i < counts.size(); i++)
+                    counts[i] += other.counts[i];
+                total += other.total;
+                sum_ns += other.sum_ns;
+                if (other.max_ns > max_ns)
+                    max_ns = other.max_ns;
+            }
+        };
+
+        // 单写者的耗时直方图 , 由一个线程record , 可在任意线程snapshot
+        class latency_histogram : public noncopyable {
+        public:
+            void record(uint64_t ns) {
+                buckets_[latency_histogram_layout::bucket_index(ns)].add();
+                total_.add();
+                sum_ns_.add(ns);
+                if (ns > max_ns_.get())
+                    max_ns_.set(ns);
+            }
+
+            latency_histogram_snapshot snapshot() const {
+                latency_histogram_snapshot result;
+                for (size_t i = 0; i < latency_histogram_layout::bucket_count; i++)
+                    result.counts[i] = buckets_[i].get();
+                result.total = total_.get();
+                result.sum_ns = sum_ns_.get();
+                result.max_ns = max_ns_.get();
+                return result;
+            }
+
+        private:
+            std::array<stat_counter, latency_histogram_layout::bucket_count> buckets_;
+            stat_counter total_;
+            stat_counter sum_ns_;
+            stat_counter max_ns_;
+        };
+    }
+}
+
+#endif  // SPDNET_BASE_LATENCY_HISTOGRAM_H_
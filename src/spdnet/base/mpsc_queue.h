@@ -0,0 +1,91 @@
+#ifndef SPDNET_BASE_MPSC_QUEUE_H
+#define SPDNET_BASE_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <spdnet/base/noncopyable.h>
+
+namespace spdnet {
+    namespace base {
+        struct mpsc_node {
+            std::atomic<mpsc_node *> next_{nullptr};
+        };
+
+        /*
+         * 侵入式的多生产者单消费者无锁队列(Vyukov) 。
+         * push只有一次原子交换 ，生产者之间没有CAS重试 ; pop/drain只能由唯一的消费者线程调用 。
+         * 生产者交换完head但还没链接next时 ，消费者会暂时看不到这个节点 ，调用方需要在push后自行唤醒消费者 。
+        **/
+        class mpsc_queue : public spdnet::base::noncopyable {
+        public:
+            mpsc_queue()
+                    : head_(&stub_), tail_(&stub_) {
+            }
+
+            void push(mpsc_node *node) {
+                node->next_.store(nullptr, std::memory_order_relaxed);
+                mpsc_node *prev = head_.exchange(node, std::memory_order_acq_rel);
+                prev->next_.store(node, std::memory_order_release);
+            }
+
+            // 一次交换入队已经用next_串好的[first, last] , 链内节点不会和其它生产者的交错
+            void push(mpsc_node *first, mpsc_node *last) {
+                last->next_.store(nullptr, std::memory_order_relaxed);
+                mpsc_node *prev = head_.exchange(last, std::memory_order_acq_rel);
+                prev->next_.store(first, std::memory_order_release);
+            }
+
+            mpsc_node *pop() {
+                mpsc_node *tail = tail_;
+                mpsc_node *next = tail->next_.load(std::memory_order_acquire);
+                if (tail == &stub_) {
+                    if (next == nullptr)
+                        return nullptr;
+                    tail_ = next;
+                    tail = next;
+                    next = next->next_.load(std::memory_order_acquire);
+                }
+                if (next != nullptr) {
+                    tail_ = next;
+                    return tail;
+                }
+                if (tail != head_.load(std::memory_order_acquire))
+                    return nullptr;
+                push(&stub_);
+                next = tail->next_.load(std::memory_order_acquire);
+                if (next != nullptr) {
+                    tail_ = next;
+                    return tail;
+                }
+                return nullptr;
+            }
+
+            // 批量取出最多max_count个节点 ，返回实际处理的数量
+            template<typename Func>
+            size_t drain(Func &&func, size_t max_count) {
+                size_t count = 0;
+                while (count < max_count) {
+                    mpsc_node *node = pop();
+                    if (node == nullptr)
+                        break;
+                    func(node);
+                    count++;
+                }
+                return count;
+            }
+
+            // 仅消费者线程调用 ; 有生产者正在push时也视为非空
+            bool empty() const {
+                return tail_ == &stub_ && stub_.next_.load(std::memory_order_acquire) == nullptr
+                       && head_.load(std::memory_order_acquire) == &stub_;
+            }
+
+        private:
+            alignas(64) std::atomic<mpsc_node *> head_;
+            alignas(64) mpsc_node *tail_;
+            mpsc_node stub_;
+        };
+    }
+}
+
+#endif //SPDNET_BASE_MPSC_QUEUE_H
@@ -0,0 +1,173 @@
+#ifndef SPDNET_BASE_NUMA_H
+#define SPDNET_BASE_NUMA_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <spdnet/base/platform.h>
+
+#if defined(SPDNET_PLATFORM_LINUX)
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#endif
+
+namespace spdnet {
+    namespace base {
+        /*
+         * cpu亲和性和numa内存策略的简单封装 。拓扑从/sys读取 , 内存策略直接走系统调用 , 不依赖libnuma 。
+         * 非linux平台只支持绑定cpu(前64个) , 节点相关的函数都当作只有一个节点 。
+        **/
+        namespace numa {
+#if defined(SPDNET_PLATFORM_LINUX)
+            namespace detail {
+                // 解析"0-3,8,10-11"格式的cpu列表
+                inline std::vector<int> parse_cpu_list(const std::string &list) {
+                    std::vector<int> cpus;
+                    size_t pos = 0;
+                    while (pos < list.size()) {
+                        size_t end = list.find(',', pos);
+                        if (end == std::string::npos)
+                            end = list.size();
+                        std::string range = list.substr(pos, end - pos);
+                        size_t dash = range.find('-');
+                        if (!range.empty() && range[0] >= '0' && range[0] <= '9') {
+                            int first = atoi(range.c_str());
+                            int last = dash == std::string::npos ? first : atoi(range.c_str() + dash + 1);
+                            for (int cpu = first; cpu <= last; cpu++)
+                                cpus.push_back(cpu);
+                        }
+                        pos = end + 1;
+                    }
+                    return cpus;
+                }
+
+                inline bool read_line(const std::string &path, std::string &line) {
+                    std::ifstream file(path);
+                    return file && std::getline(file, line);
+                }
+            }
+
+            // 节点号不一定连续 , 返回所有在线节点
+            inline std::vector<int> online_nodes() {
+                std::string line;
+                if (!detail::read_line("/sys/devices/system/node/online", line))
+                    return std::vector<int>{0};
+                std::vector<int> nodes = detail::parse_cpu_list(line);
+                if (nodes.empty())
+                    nodes.push_back(0);
+                return nodes;
+            }
+
+            inline std::vector<int> node_cpus(int node) {
+                std::string line;
+                if (!detail::read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", line)) {
+                    // 没有numa信息时当作所有cpu都在0号节点
+                    if (node == 0 && detail::read_line("/sys/devices/system/cpu/online", line))
+                        return detail::parse_cpu_list(line);
+                    return std::vector<int>();
+                }
+                return detail::parse_cpu_list(line);
+            }
+
+            // cpu所在的节点 , 未知时返回-1
+            inline int cpu_node(int cpu) {
+                for (int node : online_nodes()) {
+                    for (int node_cpu : node_cpus(node)) {
+                        if (node_cpu == cpu)
+                            return node;
+                    }
+                }
+                return -1;
+            }
+
+            // 把调用线程绑定到cpus
+            inline bool bind_current_thread(const std::vector<int> &cpus) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : cpus) {
+                    if (cpu >= 0 && cpu < CPU_SETSIZE)
+                        CPU_SET(cpu, &set);
+                }
+                if (CPU_COUNT(&set) == 0)
+                    return false;
+                return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+            }
+
+            // 调用线程之后分配的内存优先放在node上 , 该节点内存不足时仍可以用其它节点
+            inline bool prefer_node(int node) {
+                if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8))
+                    return false;
+                unsigned long mask = 1UL << node;
+                return ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask) * 8 + 1) == 0;
+            }
+
+            // 给一段已映射但未访问的内存指定首选节点 , 不受分配时所在线程的影响
+            inline bool prefer_node(void *addr, size_t len, int node) {
+                if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8))
+                    return false;
+                unsigned long mask = 1UL << node;
+                return ::syscall(SYS_mbind, addr, len, MPOL_PREFERRED, &mask, sizeof(mask) * 8 + 1, 0) == 0;
+            }
+#else
+            inline std::vector<int> online_nodes() {
+                return std::vector<int>{0};
+            }
+
+            inline std::vector<int> node_cpus(int node) {
+                std::vector<int> cpus;
+                if (node == 0) {
+                    SYSTEM_INFO info;
+                    ::GetSystemInfo(&info);
+                    for (DWORD cpu = 0; cpu < info.dwNumberOfProcessors; cpu++)
+                        cpus.push_back(static_cast<int>(cpu));
+                }
+                return cpus;
+            }
+
+            inline int cpu_node(int cpu) {
+                return cpu >= 0 ? 0 : -1;
+            }
+
+            inline bool bind_current_thread(const std::vector<int> &cpus) {
+                DWORD_PTR mask = 0;
+                for (int cpu : cpus) {
+                    if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8))
+                        mask |= static_cast<DWORD_PTR>(1) << cpu;
+                }
+                return mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+            }
+
+            inline bool prefer_node(int node) {
+                (void) node;
+                return false;
+            }
+
+            inline bool prefer_node(void *addr, size_t len, int node) {
+                (void) addr;
+                (void) len;
+                (void) node;
+                return false;
+            }
+#endif
+
+            // cpus全部在同一个节点上时返回该节点 , 否则返回-1
+            inline int cpus_node(const std::vector<int> &cpus) {
+                int node = -1;
+                for (int cpu : cpus) {
+                    int n = cpu_node(cpu);
+                    if (n < 0 || (node >= 0 && n != node))
+                        return -1;
+                    node = n;
+                }
+                return node;
+            }
+        }
+    }
+}
+
+#endif //SPDNET_BASE_NUMA_H
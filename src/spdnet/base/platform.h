@@ -58,6 +58,15 @@ inline int current_errno() {
 #define SPDNET_SOCKET_ERROR -1
 
 using thread_id_t = int;
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup)
+#define SPDNET_HAS_IO_URING 1
+#endif
+#endif
+#endif
 #else
 #include <winsock2.h>
 #include <mswsock.h>
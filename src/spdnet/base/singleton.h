@@ -1,6 +1,7 @@
 #ifndef SPDNET_BASE_SINGLETON_H_
 #define SPDNET_BASE_SINGLETON_H_
 
+#include <mutex>
 #include <spdnet/base/noncopyable.h>
 
 namespace spdnet {
@@ -0,0 +1,37 @@
+#ifndef SPDNET_BASE_STAT_COUNTER_H_
+#define SPDNET_BASE_STAT_COUNTER_H_
+
+#include <cstdint>
+#include <atomic>
+
+namespace spdnet {
+    namespace base {
+        /*
+         * 只由一个线程写、任意线程读的统计计数 。
+         * 写入是普通的读后写 , 不用带lock前缀的原子指令 , 开销和普通变量相当 ; 读到的值可能稍有滞后 。
+        **/
+        class stat_counter {
+        public:
+            void add(uint64_t n = 1) {
+                value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            void sub(uint64_t n) {
+                value_.store(value_.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+            }
+
+            void set(uint64_t n) {
+                value_.store(n, std::memory_order_relaxed);
+            }
+
+            uint64_t get() const {
+                return value_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<uint64_t> value_{0};
+        };
+    }
+}
+
+#endif  // SPDNET_BASE_STAT_COUNTER_H_
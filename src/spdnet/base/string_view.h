@@ -0,0 +1,66 @@
+#ifndef SPDNET_BASE_STRING_VIEW_H_
+#define SPDNET_BASE_STRING_VIEW_H_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define SPDNET_HAS_STD_STRING_VIEW 1
+
+#include <string_view>
+
+#endif
+
+namespace spdnet {
+    namespace base {
+        /*
+         * 不拥有数据的只读字符串视图 , 库要兼容C++11 , 不能直接用std::string_view 。
+         * C++17下可以隐式转换成std::string_view 。
+        **/
+        class string_view {
+        public:
+            string_view() = default;
+
+            string_view(const char *data, size_t len) : data_(data), len_(len) {}
+
+            string_view(const std::string &str) : data_(str.data()), len_(str.length()) {}
+
+            const char *data() const { return data_; }
+
+            size_t size() const { return len_; }
+
+            size_t length() const { return len_; }
+
+            bool empty() const { return len_ == 0; }
+
+            const char *begin() const { return data_; }
+
+            const char *end() const { return data_ + len_; }
+
+            char operator[](size_t pos) const { return data_[pos]; }
+
+            std::string to_string() const { return std::string(data_, len_); }
+
+#if defined(SPDNET_HAS_STD_STRING_VIEW)
+
+            operator std::string_view() const { return std::string_view(data_, len_); }
+
+#endif
+
+            friend bool operator==(string_view lhs, string_view rhs) {
+                return lhs.len_ == rhs.len_ && (lhs.len_ == 0 || memcmp(lhs.data_, rhs.data_, lhs.len_) == 0);
+            }
+
+            friend bool operator!=(string_view lhs, string_view rhs) {
+                return !(lhs == rhs);
+            }
+
+        private:
+            const char *data_{nullptr};
+            size_t len_{0};
+        };
+    }
+}
+
+#endif  // SPDNET_BASE_STRING_VIEW_H_
@@ -0,0 +1,177 @@
+#ifndef SPDNET_BASE_UNIQUE_FUNCTION_H
+#define SPDNET_BASE_UNIQUE_FUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace spdnet {
+    namespace base {
+        template<typename Signature, size_t InlineSize = 64>
+        class unique_function;
+
+        /*
+         * 只可移动的函数对象 。不超过InlineSize且可无异常移动的可调用对象直接存放在内部 ,
+         * 捕获几个shared_ptr的lambda投递时不再需要堆分配 ; 超出的仍然放到堆上 。
+        **/
+        template<typename R, typename... Args, size_t InlineSize>
+        class unique_function<R(Args...), InlineSize> {
+        public:
+            unique_function() noexcept = default;
+
+            unique_function(std::nullptr_t) noexcept {}
+
+            template<typename F, typename Functor = typename std::decay<F>::type,
+                    typename = typename std::enable_if<!std::is_same<Functor, unique_function>::value>::type>
+            unique_function(F &&f) {
+                construct<Functor>(std::forward<F>(f), std::integral_constant<bool, is_inline<Functor>()>());
+            }
+
+            unique_function(unique_function &&other) noexcept {
+                move_from(other);
+            }
+
+            unique_function &operator=(unique_function &&other) noexcept {
+                if (this != &other) {
+                    reset();
+                    move_from(other);
+                }
+                return *this;
+            }
+
+            unique_function &operator=(std::nullptr_t) noexcept {
+                reset();
+                return *this;
+            }
+
+            unique_function(const unique_function &) = delete;
+
+            unique_function &operator=(const unique_function &) = delete;
+
+            ~unique_function() {
+                reset();
+            }
+
+            R operator()(Args... args) {
+                return ops_->invoke(&storage_, std::forward<Args>(args)...);
+            }
+
+            explicit operator bool() const noexcept {
+                return ops_ != nullptr;
+            }
+
+            void swap(unique_function &other) noexcept {
+                unique_function tmp(std::move(other));
+                other = std::move(*this);
+                *this = std::move(tmp);
+            }
+
+        private:
+            using storage_type = typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type;
+
+            struct ops {
+                R (*invoke)(storage_type *, Args &&...);
+
+                // 把src中的对象移动到未初始化的dst并析构src
+                void (*relocate)(storage_type *dst, storage_type *src);
+
+                void (*destroy)(storage_type *);
+            };
+
+            template<typename Functor>
+            static constexpr bool is_inline() {
+                return sizeof(Functor) <= InlineSize && alignof(Functor) <= alignof(std::max_align_t)
+                       && std::is_nothrow_move_constructible<Functor>::value;
+            }
+
+            template<typename Functor>
+            struct inline_ops {
+                static Functor *get(storage_type *s) {
+                    return reinterpret_cast<Functor *>(s);
+                }
+
+                static R invoke(storage_type *s, Args &&... args) {
+                    return (*get(s))(std::forward<Args>(args)...);
+                }
+
+                static void relocate(storage_type *dst, storage_type *src) {
+                    ::new(static_cast<void *>(dst)) Functor(std::move(*get(src)));
+                    get(src)->~Functor();
+                }
+
+                static void destroy(storage_type *s) {
+                    get(s)->~Functor();
+                }
+
+                static const ops table;
+            };
+
+            template<typename Functor>
+            struct heap_ops {
+                static Functor *&get(storage_type *s) {
+                    return *reinterpret_cast<Functor **>(s);
+                }
+
+                static R invoke(storage_type *s, Args &&... args) {
+                    return (*get(s))(std::forward<Args>(args)...);
+                }
+
+                static void relocate(storage_type *dst, storage_type *src) {
+                    ::new(static_cast<void *>(dst)) Functor *(get(src));
+                }
+
+                static void destroy(storage_type *s) {
+                    delete get(s);
+                }
+
+                static const ops table;
+            };
+
+            template<typename Functor, typename F>
+            void construct(F &&f, std::true_type) {
+                ::new(static_cast<void *>(&storage_)) Functor(std::forward<F>(f));
+                ops_ = &inline_ops<Functor>::table;
+            }
+
+            template<typename Functor, typename F>
+            void construct(F &&f, std::false_type) {
+                ::new(static_cast<void *>(&storage_)) Functor *(new Functor(std::forward<F>(f)));
+                ops_ = &heap_ops<Functor>::table;
+            }
+
+            void move_from(unique_function &other) noexcept {
+                if (other.ops_ != nullptr) {
+                    other.ops_->relocate(&storage_, &other.storage_);
+                    ops_ = other.ops_;
+                    other.ops_ = nullptr;
+                }
+            }
+
+            void reset() noexcept {
+                if (ops_ != nullptr) {
+                    ops_->destroy(&storage_);
+                    ops_ = nullptr;
+                }
+            }
+
+        private:
+            storage_type storage_;
+            const ops *ops_{nullptr};
+        };
+
+        template<typename R, typename... Args, size_t InlineSize>
+        template<typename Functor>
+        const typename unique_function<R(Args...), InlineSize>::ops
+                unique_function<R(Args...), InlineSize>::inline_ops<Functor>::table = {
+                &inline_ops<Functor>::invoke, &inline_ops<Functor>::relocate, &inline_ops<Functor>::destroy};
+
+        template<typename R, typename... Args, size_t InlineSize>
+        template<typename Functor>
+        const typename unique_function<R(Args...), InlineSize>::ops
+                unique_function<R(Args...), InlineSize>::heap_ops<Functor>::table = {
+                &heap_ops<Functor>::invoke, &heap_ops<Functor>::relocate, &heap_ops<Functor>::destroy};
+    }
+}
+
+#endif //SPDNET_BASE_UNIQUE_FUNCTION_H
@@ -33,12 +33,56 @@ namespace spdnet {
 
             ~tcp_acceptor();
 
+            /*
+             * 开启后每个service_thread各自持有一个SO_REUSEPORT的监听socket ，由内核在它们之间分配新连接 ,
+             * 连接在accept它的线程上直接建立会话 ，不再经过单独的监听线程和跨线程投递 。
+             * 需要在start之前调用 , 并且event_service已经run_thread 。
+            **/
+            void set_reuse_port(bool on) {
+                reuse_port_ = on;
+            }
+
+            // 在reuse port组上挂载按cpu选择监听socket的cBPF程序 ，让同一cpu收到的连接稳定地落到同一线程
+            void set_reuse_port_cbpf(bool on) {
+                reuse_port_cbpf_ = on;
+            }
+
+            /*
+             * 按SO_INCOMING_CPU把新连接交给在处理其收包的cpu(或同一numa节点)上运行的io线程 ,
+             * 需要event_service设置了thread_placement , 否则仍随机分配 。仅对linux的单监听socket模式有效 。
+            **/
+            void set_incoming_cpu_steering(bool on) {
+                incoming_cpu_steering_ = on;
+            }
+
+            static constexpr int default_backlog = 512;
+
+            static constexpr size_t default_max_accept_per_wakeup = 64;
+
+            // listen队列长度 , 实际生效值还受限于net.core.somaxconn
+            void set_backlog(int backlog) {
+                backlog_ = backlog;
+            }
+
+            // 每次监听socket可读时最多accept的连接数 , 仅对epoll后端有效
+            void set_max_accept_per_wakeup(size_t max_accept) {
+                max_accept_per_wakeup_ = max_accept;
+            }
+
             void start(const end_point &addr, tcp_enter_callback &&enter_cb);
 
             void stop();
 
         private:
-            sock_t create_listen_socket(const end_point &addr);
+            struct thread_listener {
+                std::shared_ptr<service_thread> thread_;
+                sock_t listen_fd_;
+                std::shared_ptr<detail::accept_channel_impl> accept_channel_;
+            };
+
+            void start_reuse_port(const end_point &addr, tcp_enter_callback &&enter_cb);
+
+            sock_t create_listen_socket(const end_point &addr, bool reuse_port = false);
 
         private:
             event_service &service_;
@@ -47,6 +91,12 @@ namespace spdnet {
             std::shared_ptr<service_thread> listen_thread_;
             std::shared_ptr<bool> run_listen_;
             std::shared_ptr<detail::accept_channel_impl> accept_channel_;
+            int backlog_{default_backlog};
+            size_t max_accept_per_wakeup_{default_max_accept_per_wakeup};
+            bool reuse_port_{false};
+            bool reuse_port_cbpf_{false};
+            bool incoming_cpu_steering_{false};
+            std::vector<thread_listener> thread_listeners_;
         };
 
 
@@ -28,36 +28,106 @@ namespace spdnet {
 
         void tcp_acceptor::start(const end_point &addr, tcp_enter_callback &&enter_cb) {
             addr_ = addr;
+#if defined(SPDNET_PLATFORM_LINUX)
+            if (reuse_port_) {
+                start_reuse_port(addr, std::move(enter_cb));
+                return;
+            }
+#endif
             listen_fd_ = create_listen_socket(addr);
             if (listen_fd_ == invalid_socket) {
                 throw spdnet_exception(std::string("listen error : ") + std::to_string(current_errno()));
             }
-            socket_ops::socket_non_block(listen_fd_);
             auto &service = service_;
 #if defined(SPDNET_PLATFORM_WINDOWS)
+            socket_ops::socket_non_block(listen_fd_);
             accept_channel_ = std::make_shared<detail::accept_channel_impl>(listen_fd_, addr, [&service, enter_cb](sock_t new_socket) {
                 service.add_tcp_session(new_socket, true, enter_cb);
 
                 });
 #else
+            bool steering = incoming_cpu_steering_;
             accept_channel_ = std::make_shared<detail::accept_channel_impl>(listen_fd_,
-                                                                            [&service, enter_cb](sock_t new_socket) {
+                                                                            [&service, enter_cb, steering](sock_t new_socket) {
+                                                                                std::shared_ptr<service_thread> thread;
+                                                                                if (steering)
+                                                                                    thread = service.get_service_thread_for_cpu(
+                                                                                            socket_ops::socket_incoming_cpu(new_socket));
                                                                                 service.add_tcp_session(new_socket,
                                                                                                         true,
-                                                                                                        enter_cb);
-                                                                            });
+                                                                                                        enter_cb,
+                                                                                                        thread);
+                                                                            },
+                                                                            max_accept_per_wakeup_);
 #endif
             run_listen_ = std::make_shared<bool>(true);
-            listen_thread_ = std::make_shared<service_thread>(default_loop_timeout);/*service_.service_thread();*/
+            listen_thread_ = std::make_shared<service_thread>(default_loop_timeout, service_.backend());/*service_.service_thread();*/
             listen_thread_->run(run_listen_);
             if (!listen_thread_->get_impl()->start_accept(listen_fd_, accept_channel_.get())) {
                 throw spdnet_exception(std::string("listen error : ") + std::to_string(current_errno()));
             }
         }
 
+#if defined(SPDNET_PLATFORM_LINUX)
+
+        void tcp_acceptor::start_reuse_port(const end_point &addr, tcp_enter_callback &&enter_cb) {
+            const auto &threads = service_.get_service_threads();
+            if (threads.empty()) {
+                throw spdnet_exception(std::string("reuse port acceptor requires running service threads"));
+            }
+            auto &service = service_;
+            for (const auto &thread : threads) {
+                sock_t listen_fd = create_listen_socket(addr, true);
+                if (listen_fd == invalid_socket) {
+                    int err = current_errno();
+                    stop();
+                    throw spdnet_exception(std::string("listen error : ") + std::to_string(err));
+                }
+                // 回调在该线程的io循环里执行 ，add_tcp_session会立即在本线程建立会话
+                auto accept_channel = std::make_shared<detail::accept_channel_impl>(
+                        listen_fd, [&service, enter_cb, thread](sock_t new_socket) {
+                            service.add_tcp_session(new_socket, true, enter_cb, thread);
+                        }, max_accept_per_wakeup_);
+                thread_listeners_.push_back(thread_listener{thread, listen_fd, accept_channel});
+            }
+
+            if (reuse_port_cbpf_ && socket_ops::attach_reuse_port_cbpf(
+                    thread_listeners_.front().listen_fd_,
+                    static_cast<uint32_t>(thread_listeners_.size())) == SPDNET_SOCKET_ERROR) {
+                std::cerr << "attach reuse port cbpf error . errno:" << current_errno() << std::endl;
+            }
+
+            for (const auto &listener : thread_listeners_) {
+                if (!listener.thread_->get_impl()->start_accept(listener.listen_fd_,
+                                                                listener.accept_channel_.get())) {
+                    int err = current_errno();
+                    stop();
+                    throw spdnet_exception(std::string("listen error : ") + std::to_string(err));
+                }
+            }
+        }
+
+#endif
+
         void tcp_acceptor::stop() {
+            // 监听socket在这里解除关联并关闭 , 不依赖io线程还在运行 , 否则循环已退出时端口一直被占用
+            for (const auto &listener : thread_listeners_) {
+                auto thread = listener.thread_;
+                thread->get_impl()->unlink_channel(listener.listen_fd_);
+                socket_ops::close_socket(listener.listen_fd_);
+                // 已经取到的事件可能还引用channel , 交给io线程在之后释放 ; 循环已退出时不会再有事件
+                if (thread->is_running()) {
+                    auto collector = thread->get_channel_collector();
+                    auto accept_channel = listener.accept_channel_;
+                    thread->get_executor()->post([collector, accept_channel]() {
+                        collector->put_channel(accept_channel);
+                    });
+                }
+            }
+            thread_listeners_.clear();
+
             try {
-                if (*run_listen_) {
+                if (run_listen_ && *run_listen_) {
                     *run_listen_ = false;
                     if (listen_thread_->get_thread()->joinable())
                         listen_thread_->get_thread()->join();
@@ -71,8 +141,12 @@ namespace spdnet {
 
         }
 
-        sock_t tcp_acceptor::create_listen_socket(const end_point &addr) {
+        sock_t tcp_acceptor::create_listen_socket(const end_point &addr, bool reuse_port) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            sock_t fd = ::socket(addr.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+#else
             sock_t fd = ::socket(addr.family(), SOCK_STREAM, 0);
+#endif
             if (fd == invalid_socket) {
                 return invalid_socket;
             }
@@ -83,8 +157,17 @@ namespace spdnet {
                 return invalid_socket;
             }
 
+#if defined(SPDNET_PLATFORM_LINUX)
+            if (reuse_port && socket_ops::socket_reuse_port(fd) < 0) {
+                socket_ops::close_socket(fd);
+                return invalid_socket;
+            }
+#else
+            (void) reuse_port;
+#endif
+
             int ret = ::bind(fd, addr.socket_addr(), addr.socket_addr_len());
-            if (ret == SPDNET_SOCKET_ERROR || listen(fd, 512) == SPDNET_SOCKET_ERROR) {
+            if (ret == SPDNET_SOCKET_ERROR || listen(fd, backlog_) == SPDNET_SOCKET_ERROR) {
                 socket_ops::close_socket(fd);
                 return invalid_socket;
             }
@@ -23,10 +23,23 @@ namespace spdnet {
             while (cancel_token_->exchange(true));
             std::lock_guard<std::mutex> lck(context_guard_);
             for (auto &pair : connecting_context_) {
-                socket_ops::close_socket(pair.first);
                 auto context = pair.second;
                 auto thread = context->get_service_thread();
+#if defined(SPDNET_PLATFORM_LINUX)
+                // 在途的连接操作引用context , 在io线程里解除关联后再关闭socket和释放context
+                if (thread->is_running()) {
+                    auto collector = thread->get_channel_collector();
+                    thread->get_executor()->post([context, collector]() {
+                        context->cancel();
+                        collector->put_channel(context);
+                    });
+                } else {
+                    context->cancel();
+                }
+#else
+                socket_ops::close_socket(pair.first);
                 thread->get_channel_collector()->put_channel(context);
+#endif
             }
             connecting_context_.clear();
         }
@@ -40,12 +53,18 @@ namespace spdnet {
 
         void async_connector::async_connect(const end_point &addr, tcp_enter_callback &&enter_cb,
                                             connect_failed_callback &&failed_cb) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            sock_t client_fd = socket_ops::create_socket(addr.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (client_fd == invalid_socket)
+                return;
+#else
             sock_t client_fd = socket_ops::create_socket(addr.family(), SOCK_STREAM, 0);
             if (client_fd == invalid_socket)
                 return;
             socket_ops::socket_non_block(client_fd);
+#endif
 
-            auto thread = service_.get_service_thread();
+            auto thread = service_.get_service_thread(addr);
             auto enter = std::move(enter_cb);
             auto failed = std::move(failed_cb);
             auto &this_ref = *this;
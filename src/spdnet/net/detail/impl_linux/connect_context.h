@@ -8,7 +8,7 @@
 #include <spdnet/net/end_point.h>
 #include <spdnet/base/platform.h>
 #include <spdnet/net/detail/impl_linux/epoll_channel.h>
-#include <spdnet/net/detail/impl_linux/epoll_impl.h>
+#include <spdnet/net/detail/impl_linux/io_impl.h>
 
 namespace spdnet {
     namespace net {
@@ -60,8 +60,16 @@ namespace spdnet {
                 }
 
                 void cancel_event() {
-                    struct epoll_event ev{0, {nullptr}};
-                    ::epoll_ctl(service_thread_->get_impl()->epoll_fd(), EPOLL_CTL_DEL, fd_, &ev);
+                    service_thread_->get_impl()->unlink_channel(fd_);
+                }
+
+                // 放弃连接 , 先解除关联再关闭socket ; 回调里已经关闭的不再重复关闭 。只能在io线程调用
+                void cancel() {
+                    if (fd_ == invalid_socket)
+                        return;
+                    cancel_event();
+                    socket_ops::close_socket(fd_);
+                    fd_ = invalid_socket;
                 }
 
                 std::shared_ptr<service_thread> get_service_thread() {
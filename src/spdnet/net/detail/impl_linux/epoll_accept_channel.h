@@ -11,8 +11,12 @@ namespace spdnet {
         namespace detail {
             class epoll_accept_channel : public channel {
             public:
-                epoll_accept_channel(sock_t listen_fd, std::function<void(sock_t fd)> &&success_cb)
+                static constexpr size_t default_max_accept_per_wakeup = 64;
+
+                epoll_accept_channel(sock_t listen_fd, std::function<void(sock_t fd)> &&success_cb,
+                                     size_t max_accept_per_wakeup = default_max_accept_per_wakeup)
                         : listen_fd_(listen_fd), success_cb_(success_cb),
+                          max_accept_per_wakeup_(max_accept_per_wakeup > 0 ? max_accept_per_wakeup : 1),
                           idle_fd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
 
                 }
@@ -21,21 +25,42 @@ namespace spdnet {
 
                 void on_close() override {}
 
+                // 监听socket是水平触发的 , 超过上限的连接留给下一次epoll_wait , 避免饿死同线程的其它事件
                 void on_recv() override {
-                    sock_t accept_fd = ::accept(listen_fd_, nullptr, nullptr);
-                    if (accept_fd == -1) {
-                        if (current_errno() == EMFILE) {
-                            ::close(idle_fd_);
-                            accept_fd = ::accept(listen_fd_, nullptr, nullptr);
-                            ::close(accept_fd);
-                            idle_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    for (size_t i = 0; i < max_accept_per_wakeup_; i++) {
+                        sock_t accept_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                        if (accept_fd == -1) {
+                            int err = current_errno();
+                            if (err == EAGAIN || err == EWOULDBLOCK)
+                                break;
+                            if (err == EINTR || err == ECONNABORTED)
+                                continue;
+                            on_accept_failed(err);
+                            break;
                         }
-                        std::cerr << "accept error . errno:" << current_errno() << std::endl;
-                        return;
+                        on_accepted(accept_fd);
                     }
+                }
+
+                // io_uring后端由内核完成accept ，结果通过下面两个接口回传
+                void on_accepted(sock_t accept_fd) {
                     success_cb_(accept_fd);
                 }
 
+                void on_accept_failed(int err) {
+                    if (err == EMFILE) {
+                        ::close(idle_fd_);
+                        sock_t accept_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+                        ::close(accept_fd);
+                        idle_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    }
+                    std::cerr << "accept error . errno:" << err << std::endl;
+                }
+
+                sock_t listen_fd() const {
+                    return listen_fd_;
+                }
+
                 ~epoll_accept_channel() {
                     socket_ops::close_socket(idle_fd_);
                 }
@@ -43,6 +68,7 @@ namespace spdnet {
             private:
                 sock_t listen_fd_{invalid_socket};
                 std::function<void(sock_t fd)> success_cb_;
+                size_t max_accept_per_wakeup_;
                 sock_t idle_fd_;
             };
 
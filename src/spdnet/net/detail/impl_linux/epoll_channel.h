@@ -14,6 +14,9 @@ namespace spdnet {
 
                 virtual void on_close() = 0;
 
+                // EPOLLERR : 错误队列里有数据(如MSG_ZEROCOPY的完成通知)
+                virtual void on_error() {}
+
             };
 
         }
@@ -13,6 +13,7 @@
 #include <spdnet/net/socket_data.h>
 #include <spdnet/net/end_point.h>
 #include <spdnet/net/channel_collector.h>
+#include <spdnet/net/detail/impl_linux/io_impl.h>
 #include <spdnet/net/detail/impl_linux/epoll_wakeup_channel.h>
 
 namespace spdnet {
@@ -23,7 +24,7 @@ namespace spdnet {
         namespace detail {
             class channel;
 
-            class epoll_impl : public spdnet::base::noncopyable, public std::enable_shared_from_this<epoll_impl> {
+            class epoll_impl : public io_impl {
             public:
                 friend class epoll_socket_channel;
 
@@ -33,35 +34,44 @@ namespace spdnet {
 
                 virtual ~epoll_impl() noexcept;
 
-                bool on_socket_enter(socket_data::ptr data);
+                io_backend backend() const override { return io_backend::epoll; }
 
-                void run_once(uint32_t timeout);
+                bool on_socket_enter(socket_data::ptr data) override;
 
-                void post_flush(socket_data *socket_data);
+                size_t run_once(uint32_t timeout) override;
 
-                void shutdown_socket(socket_data::ptr data);
+                void post_flush(socket_data *socket_data) override;
+
+                void shutdown_socket(socket_data::ptr data) override;
+
+                void close_socket(socket_data::ptr data) override;
 
                 int epoll_fd() const { return epoll_fd_; }
 
                 bool link_channel(int fd, const channel *channel, uint32_t events);
 
-                bool start_accept(sock_t listen_fd, const channel *channel);
+                void unlink_channel(sock_t fd) override;
 
-                bool async_connect(sock_t client_fd, const end_point &addr, channel *channel);
+                bool start_accept(sock_t listen_fd, accept_channel_impl *channel) override;
 
-                void wakeup();
+                bool async_connect(sock_t client_fd, const end_point &addr, channel *channel) override;
 
-                spdnet::base::buffer *alloc_buffer(size_t size) {
-                    return buffer_pool_.alloc_buffer(size);
-                }
+                void wakeup() override;
 
-                void recycle_buffer(spdnet::base::buffer *buffer) {
-                    buffer_pool_.recycle_buffer(buffer);
+                bool support_migration() const override {
+                    return true;
                 }
 
-            private:
-                void close_socket(socket_data::ptr data);
+                bool detach_socket(socket_data::ptr data) override;
+
+                bool attach_socket(socket_data::ptr data) override;
 
+                void on_loop_exit() override;
+
+                // 关闭后保持打开的socket已经收到全部零拷贝通知
+                void on_zerocopy_drained(socket_data::ptr data);
+
+            private:
                 void add_write_event(socket_data::ptr data);
 
                 void cancel_write_event(socket_data::ptr data);
@@ -71,14 +81,15 @@ namespace spdnet {
             private:
                 int epoll_fd_;
                 epoll_wakeup_channel wakeup_;
-                spdnet::base::buffer_pool buffer_pool_;
                 std::vector<epoll_event> event_entries_;
-                std::shared_ptr<task_executor> task_executor_;
-                std::shared_ptr<channel_collector> channel_collector_;
-                std::function<void(sock_t)> socket_close_notify_cb_;
-            };
 
-            using io_object_impl_type = epoll_impl;
+                // 关闭时还有零拷贝发送在途的socket , channel引用impl , 在on_loop_exit中清空以解除循环引用
+                struct lingering_socket {
+                    socket_data::ptr data;
+                    std::shared_ptr<channel> ch;
+                };
+                std::unordered_map<sock_t, lingering_socket> zerocopy_lingering_;
+            };
         }
     }
 }
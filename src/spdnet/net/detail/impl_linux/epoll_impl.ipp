@@ -17,12 +17,11 @@ namespace spdnet {
             epoll_impl::epoll_impl(std::shared_ptr<task_executor> task_executor,
                                    std::shared_ptr<channel_collector> channel_collector,
                                    std::function<void(sock_t)> &&socket_close_notify_cb)
-                    : epoll_fd_(::epoll_create(1)),
-                      task_executor_(task_executor),
-                      channel_collector_(channel_collector),
-                      socket_close_notify_cb_(socket_close_notify_cb) {
+                    : io_impl(task_executor, channel_collector, std::move(socket_close_notify_cb)),
+                      epoll_fd_(::epoll_create(1)) {
                 link_channel(wakeup_.eventfd(), &wakeup_, EPOLLET | EPOLLIN | EPOLLRDHUP);
                 event_entries_.resize(1024);
+                metrics_.event_capacity.set(event_entries_.size());
             }
 
             epoll_impl::~epoll_impl() noexcept {
@@ -51,19 +50,32 @@ namespace spdnet {
                 return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
             }
 
+            void epoll_impl::unlink_channel(sock_t fd) {
+                struct epoll_event ev{0, {nullptr}};
+                ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &ev);
+            }
+
             void epoll_impl::post_flush(socket_data *socket_data) {
-                task_executor_->post([socket_data]() {
-                    if (socket_data->is_can_write_) {
-                        socket_data->channel_->flush_buffer();
+                task_executor_->post([this, socket_data]() {
+                    // socket已迁移到其它线程 , flush状态仍然保持 , 交给新线程执行
+                    auto owner = static_cast<const io_impl *>(socket_data->owner_impl_.load(std::memory_order_acquire));
+                    if (SPDNET_PREDICT_FALSE(owner != this && owner != nullptr)) {
+                        const_cast<io_impl *>(owner)->post_flush(socket_data);
+                        return;
+                    }
+                    auto pin = std::move(socket_data->migration_pin_);
+                    socket_data->clear_flush_scheduled();
+                    // 迁移过程中还没有关联channel , 由attach之后的flush发送
+                    if (socket_data->is_can_write_ && socket_data->channel_ != nullptr) {
+                        static_cast<epoll_socket_channel *>(socket_data->channel_.get())->flush_buffer();
                     }
-                    socket_data->is_post_flush_ = false;
                 }, false);
             }
 
-            bool epoll_impl::start_accept(sock_t listen_fd, const channel *ch) {
+            bool epoll_impl::start_accept(sock_t listen_fd, accept_channel_impl *ch) {
                 struct epoll_event ev;
                 ev.events = EPOLLIN;
-                ev.data.ptr = (void *) ch;
+                ev.data.ptr = (void *) static_cast<channel *>(ch);
                 if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd, &ev) != 0) {
                     return false;
                 }
@@ -93,15 +105,46 @@ namespace spdnet {
 
                 // close_socket函数可能正在被channel调用 ， 将channel加入到待删除列表 ，是防止channel被立即释放引起crash
                 channel_collector_->put_channel(data->channel_);
-                // cancel event
-                struct epoll_event ev{0, {nullptr}};
-                ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, data->sock_fd(), &ev);
+                if (SPDNET_PREDICT_FALSE(data->has_inflight_zerocopy())) {
+                    // socket保持打开直到零拷贝通知到齐 , 只关注错误队列 ; 对端在已排队的数据之后收到FIN
+                    zerocopy_lingering_[data->sock_fd()] = lingering_socket{data, data->channel_};
+                    struct epoll_event ev{0, {nullptr}};
+                    ev.events = EPOLLET;
+                    ev.data.ptr = data->channel_.get();
+                    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, data->sock_fd(), &ev);
+                    ::shutdown(data->sock_fd(), SHUT_WR);
+                } else {
+                    // cancel event
+                    struct epoll_event ev{0, {nullptr}};
+                    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, data->sock_fd(), &ev);
+                }
 
                 socket_close_notify_cb_(data->sock_fd());
 
+                data->drop_pending_send_bytes(*this);
                 data->close();
             }
 
+            void epoll_impl::on_zerocopy_drained(socket_data::ptr data) {
+                auto iter = zerocopy_lingering_.find(data->sock_fd());
+                if (iter == zerocopy_lingering_.end() || iter->second.data != data)
+                    return;
+                unlink_channel(data->sock_fd());
+                // 正在该channel的on_error里 , 延迟释放
+                channel_collector_->put_channel(iter->second.ch);
+                zerocopy_lingering_.erase(iter);
+                data->close_lingering_fd();
+            }
+
+            void epoll_impl::on_loop_exit() {
+                // 之后不会再读取错误队列 , 关闭socket , 未完成的包在socket_data析构时放弃
+                for (auto &item : zerocopy_lingering_) {
+                    unlink_channel(item.first);
+                    item.second.data->close_lingering_fd();
+                }
+                zerocopy_lingering_.clear();
+            }
+
             void epoll_impl::shutdown_socket(socket_data::ptr data) {
                 if (data->has_closed_)
                     return;
@@ -110,18 +153,55 @@ namespace spdnet {
             }
 
             bool epoll_impl::on_socket_enter(socket_data::ptr data) {
-                auto impl = shared_from_this();
+                auto impl = std::static_pointer_cast<epoll_impl>(shared_from_this());
                 data->channel_ = std::make_shared<epoll_socket_channel>(impl, data);
-                return link_channel(data->sock_fd(), data->channel_.get(), EPOLLET | EPOLLIN | EPOLLRDHUP);
+                data->owner_impl_.store(static_cast<const io_impl *>(this), std::memory_order_release);
+                // 会话还没加入service_thread , 失败时不走close_socket的关闭通知 , 直接关闭
+                if (!link_channel(data->sock_fd(), data->channel_.get(), EPOLLET | EPOLLIN | EPOLLRDHUP)) {
+                    data->close();
+                    return false;
+                }
+                return true;
             }
 
+            bool epoll_impl::detach_socket(socket_data::ptr data) {
+                if (data->has_closed_ || data->channel_ == nullptr)
+                    return false;
+                unlink_channel(data->sock_fd());
+                // 本轮可能还有该channel的事件没处理完 , 延迟释放
+                channel_collector_->put_channel(data->channel_);
+                data->channel_ = nullptr;
+                // 未发送的字节随会话转到新线程的统计
+                metrics_.pending_send_bytes.sub(data->pending_send_bytes_);
+                return true;
+            }
 
-            void epoll_impl::run_once(uint32_t timeout) {
+            bool epoll_impl::attach_socket(socket_data::ptr data) {
+                auto impl = std::static_pointer_cast<epoll_impl>(shared_from_this());
+                data->channel_ = std::make_shared<epoll_socket_channel>(impl, data);
+                metrics_.pending_send_bytes.add(data->pending_send_bytes_);
+                uint32_t events = EPOLLET | EPOLLIN | EPOLLRDHUP;
+                // 原线程在等待可写 , 边沿触发下添加时就会报告当前可写状态
+                if (!data->is_can_write_ && !data->pending_packet_list_.empty())
+                    events |= EPOLLOUT;
+                if (!link_channel(data->sock_fd(), data->channel_.get(), events)) {
+                    close_socket(data);
+                    return false;
+                }
+                return true;
+            }
+
+
+            size_t epoll_impl::run_once(uint32_t timeout) {
                 int num_events = ::epoll_wait(epoll_fd_, event_entries_.data(), event_entries_.size(), timeout);
+                mark_wakeup();
                 for (int i = 0; i < num_events; i++) {
                     auto ch = static_cast<channel *>(event_entries_[i].data.ptr);
                     auto event = event_entries_[i].events;
 
+                    if (SPDNET_PREDICT_FALSE(event & EPOLLERR)) {
+                        ch->on_error();
+                    }
                     if (SPDNET_PREDICT_FALSE(event & EPOLLRDHUP)) {
                         ch->on_recv();
                         ch->on_close();
@@ -137,10 +217,13 @@ namespace spdnet {
 
                 if (SPDNET_PREDICT_FALSE(num_events == static_cast<int>(event_entries_.size()))) {
                     event_entries_.resize(event_entries_.size() * 2);
+                    metrics_.event_capacity.set(event_entries_.size());
+                    metrics_.event_capacity_grows.add();
                 }
 
                 // release channel
                 // del_channel_list_.clear();
+                return num_events > 0 ? static_cast<size_t>(num_events) : 0;
             }
         }
     }
@@ -1,6 +1,7 @@
 #ifndef SPDNET_NET_EPOLL_SOCKET_CHANNEL_H_
 #define SPDNET_NET_EPOLL_SOCKET_CHANNEL_H_
 
+#include <sys/sendfile.h>
 #include <spdnet/base/noncopyable.h>
 #include <spdnet/base/platform.h>
 #include <spdnet/net/detail/impl_linux/epoll_impl.h>
@@ -23,60 +24,50 @@ namespace spdnet {
                     if (data_->has_closed_)
                         return;
                     bool force_close = false;
-                    {
-                        std::lock_guard<spdnet::base::spin_lock> lck(data_->send_guard_);
-                        if (SPDNET_PREDICT_TRUE(data_->pending_packet_list_.empty())) {
-                            data_->pending_packet_list_.swap(data_->send_packet_list_);
-                        } else {
-                            for (const auto &packet : data_->send_packet_list_)
-                                data_->pending_packet_list_.push_back(packet);
-                            data_->send_packet_list_.clear();
-                        }
-                    }
+                    data_->merge_send_packets(*impl_);
 
                     constexpr size_t MAX_IOVEC = 1024;
                     struct iovec iov[MAX_IOVEC];
                     while (!data_->pending_packet_list_.empty()) {
-                        size_t cnt = 0;
-                        size_t prepare_send_len = 0;
-                        for (const auto &packet : data_->pending_packet_list_) {
-                            iov[cnt].iov_base = packet.buffer_->get_data_ptr();
-                            iov[cnt].iov_len = packet.buffer_->get_length();
-                            prepare_send_len += packet.buffer_->get_length();
-                            cnt++;
-                            if (cnt >= MAX_IOVEC)
+                        ssize_t send_len = 0;
+                        auto &front = data_->pending_packet_list_.front();
+                        if (SPDNET_PREDICT_FALSE(front.is_file())) {
+                            data_->trace_send_attempt(*impl_, 1);
+                            off_t offset = front.file_offset_;
+                            send_len = ::sendfile(data_->sock_fd(), front.file_fd_, &offset, front.length());
+                            if (SPDNET_PREDICT_FALSE(send_len == 0)) {
+                                // 文件比指定的区间短 , 剩余的数据永远发不出去
+                                force_close = true;
                                 break;
+                            }
+                        } else if (SPDNET_PREDICT_FALSE(data_->is_zerocopy_packet(front))) {
+                            data_->trace_send_attempt(*impl_, 1);
+                            send_len = send_zerocopy(front);
+                        } else {
+                            struct iovec *vec = iov;
+                            size_t cnt = data_->prepare_send_packets(MAX_IOVEC, [&vec](const char *data, size_t len) {
+                                vec->iov_base = const_cast<char *>(data);
+                                vec->iov_len = len;
+                                vec++;
+                            });
+                            assert(cnt > 0);
+                            data_->trace_send_attempt(*impl_, cnt);
+                            send_len = ::writev(data_->sock_fd(), iov, static_cast<int>(cnt));
                         }
-                        assert(cnt > 0);
-                        const int send_len = ::writev(data_->sock_fd(), iov, static_cast<int>(cnt));
+                        impl_->metrics().send_calls.add();
                         if (SPDNET_PREDICT_FALSE(send_len < 0)) {
                             if (errno == EAGAIN) {
+                                impl_->metrics().eagain.add();
                                 impl_->add_write_event(data_);
                                 data_->is_can_write_ = false;
                             } else {
                                 force_close = true;
                             }
                             break;
-                        } else {
-                            size_t tmp_len = send_len;
-                            for (auto iter = data_->pending_packet_list_.begin();
-                                 iter != data_->pending_packet_list_.end();) {
-                                auto &packet = *iter;
-                                if (SPDNET_PREDICT_TRUE(packet.buffer_->get_length() <= tmp_len)) {
-                                    tmp_len -= packet.buffer_->get_length();
-                                    packet.buffer_->clear();
-                                    impl_->recycle_buffer(packet.buffer_);
-                                    if (packet.callback_)
-                                        packet.callback_();
-                                    iter = data_->pending_packet_list_.erase(iter);
-                                } else {
-                                    packet.buffer_->remove_length(tmp_len);
-                                    impl_->add_write_event(data_);
-                                    data_->is_can_write_ = false;
-                                    break;
-                                }
-
-                            }
+                        } else if (data_->remove_sent_packets(*impl_, static_cast<size_t>(send_len))) {
+                            impl_->add_write_event(data_);
+                            data_->is_can_write_ = false;
+                            break;
                         }
                     }
 
@@ -86,6 +77,51 @@ namespace spdnet {
                 }
 
             private:
+                ssize_t send_zerocopy(const socket_data::send_packet &packet) {
+                    struct iovec vec;
+                    vec.iov_base = const_cast<char *>(packet.data());
+                    vec.iov_len = packet.length();
+                    struct msghdr msg;
+                    memset(&msg, 0, sizeof(msg));
+                    msg.msg_iov = &vec;
+                    msg.msg_iovlen = 1;
+                    ssize_t send_len = ::sendmsg(data_->sock_fd(), &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+                    if (send_len > 0) {
+                        data_->on_zerocopy_sent();
+                    } else if (send_len < 0 && errno == ENOBUFS) {
+                        // 超过optmem限制 , 这次退回普通拷贝发送
+                        send_len = ::sendmsg(data_->sock_fd(), &msg, MSG_NOSIGNAL);
+                    }
+                    return send_len;
+                }
+
+                void on_error() override {
+                    // 读取错误队列中的MSG_ZEROCOPY完成通知
+                    char control[128];
+                    while (true) {
+                        struct msghdr msg;
+                        memset(&msg, 0, sizeof(msg));
+                        msg.msg_control = control;
+                        msg.msg_controllen = sizeof(control);
+                        if (::recvmsg(data_->sock_fd(), &msg, MSG_ERRQUEUE) < 0)
+                            break;
+                        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+                            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                                  || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+                                continue;
+                            auto serr = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+                            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                                continue;
+                            // 内核仍然做了拷贝(如回环或网卡不支持) , 之后不再使用零拷贝
+                            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                                data_->zerocopy_threshold_ = 0;
+                            data_->on_zerocopy_complete(*impl_, serr->ee_info, serr->ee_data);
+                        }
+                    }
+                    if (SPDNET_PREDICT_FALSE(data_->has_closed_ && !data_->has_inflight_zerocopy()))
+                        impl_->on_zerocopy_drained(data_);
+                }
+
                 void on_send() override {
                     impl_->cancel_write_event(data_);
                     data_->is_can_write_ = true;
@@ -101,78 +137,47 @@ namespace spdnet {
                 }
 
                 void do_recv() {
-                    char stack_buffer[65536];
+                    constexpr size_t MAX_RECV_IOVEC = 16;
                     bool force_close = false;
                     auto &recv_buffer = data_->recv_buffer_;
+                    // 读满说明还有大量数据 , 逐次扩大准备的空间 , 直到max_recv_buffer_size_
+                    size_t recv_window = spdnet::base::chain_buffer::block_size;
                     while (true) {
-                        size_t valid_count = recv_buffer.get_write_valid_count();
-                        struct iovec vec[2];
-                        vec[0].iov_base = recv_buffer.get_write_ptr();
-                        vec[0].iov_len = valid_count;
-                        vec[1].iov_base = stack_buffer;
-                        vec[1].iov_len = sizeof(stack_buffer);
-
-
-                        size_t try_recv_len = valid_count + sizeof(stack_buffer);
-
-                        int recv_len = static_cast<int>(::readv(data_->sock_fd(), vec, 2));
+                        struct iovec vec[MAX_RECV_IOVEC];
+                        struct iovec *iov = vec;
+                        size_t try_recv_len = 0;
+                        size_t cnt = recv_buffer.prepare(*impl_, recv_window, MAX_RECV_IOVEC,
+                                                         [&iov, &try_recv_len](char *data, size_t len) {
+                                                             iov->iov_base = data;
+                                                             iov->iov_len = len;
+                                                             iov++;
+                                                             try_recv_len += len;
+                                                         });
+
+                        ssize_t recv_len = ::readv(data_->sock_fd(), vec, static_cast<int>(cnt));
+                        impl_->metrics().on_recv(recv_len > 0 ? static_cast<size_t>(recv_len) : 0);
                         if (SPDNET_PREDICT_FALSE(recv_len == 0 || (recv_len < 0 && errno != EAGAIN))) {
                             force_close = true;
                             break;
                         }
-                        size_t stack_len = 0;
-                        if (SPDNET_PREDICT_FALSE(recv_len > (int) valid_count)) {
-                            recv_buffer.add_write_pos(valid_count);
-                            stack_len = recv_len - valid_count;
-                        } else
-                            recv_buffer.add_write_pos(recv_len);
-
-                        if (SPDNET_PREDICT_TRUE(nullptr != data_->data_callback_)) {
-                            size_t len = data_->data_callback_(recv_buffer.get_data_ptr(), recv_buffer.get_length());
-                            assert(len <= recv_buffer.get_length());
-                            if (SPDNET_PREDICT_TRUE(len == recv_buffer.get_length())) {
-                                recv_buffer.remove_length(len);
-                                if (stack_len > 0) {
-                                    len = data_->data_callback_(stack_buffer, stack_len);
-                                    assert(len <= stack_len);
-                                    if (len < stack_len) {
-                                        recv_buffer.write(stack_buffer + len, stack_len - len);
-                                    } else if (len > stack_len) {
-                                        force_close = true;
-                                        break;
-                                    }
-                                }
-                            } else if (len < recv_buffer.get_length()) {
-                                recv_buffer.remove_length(len);
-                                if (stack_len > 0)
-                                    recv_buffer.write(stack_buffer, stack_len);
-                            } else {
-                                force_close = true;
-                                break;
-                            }
-
+                        if (recv_len < 0) {
+                            impl_->metrics().eagain.add();
+                            break;
                         }
 
-                        if (SPDNET_PREDICT_FALSE(
-                                recv_len >= (int) recv_buffer.get_capacity()/* + (int)(sizeof(stack_buffer))*/)) {
-                            size_t grow_len = 0;
-                            if (recv_buffer.get_capacity() * 2 <= data_->max_recv_buffer_size_)
-                                grow_len = recv_buffer.get_capacity();
-                            else
-                                grow_len = data_->max_recv_buffer_size_ - recv_buffer.get_capacity();
-
-                            if (grow_len > 0)
-                                recv_buffer.grow(grow_len);
+                        recv_buffer.commit(static_cast<size_t>(recv_len));
+                        if (SPDNET_PREDICT_FALSE(!data_->deliver_recv_data(*impl_))) {
+                            force_close = true;
+                            break;
                         }
 
-                        if (SPDNET_PREDICT_FALSE(
-                                recv_buffer.get_write_valid_count() == 0 || recv_buffer.get_length() == 0))
-                            recv_buffer.adjust_to_head();
-
-                        if (recv_len < static_cast<int>(try_recv_len))
+                        if (data_->has_closed_ || static_cast<size_t>(recv_len) < try_recv_len)
                             break;
+                        if (recv_window < data_->max_recv_buffer_size_)
+                            recv_window *= 2;
                     }
 
+                    recv_buffer.shrink(*impl_);
                     if (force_close)
                         impl_->close_socket(data_);
                 }
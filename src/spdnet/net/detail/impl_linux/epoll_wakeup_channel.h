@@ -18,7 +18,8 @@ namespace spdnet {
                 }
 
                 void wakeup() {
-                    int data = 1;
+                    // eventfd要求写入8字节
+                    uint64_t data = 1;
                     ::write(fd_, &data, sizeof(data));
                 }
 
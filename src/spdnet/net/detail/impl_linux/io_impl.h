@@ -0,0 +1,141 @@
+#ifndef SPDNET_NET_IO_IMPL_H_
+#define SPDNET_NET_IO_IMPL_H_
+
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/platform.h>
+#include <spdnet/base/buffer_pool.h>
+#include <spdnet/base/hugepage_arena.h>
+#include <spdnet/net/socket_data.h>
+#include <spdnet/net/end_point.h>
+#include <spdnet/net/io_backend.h>
+#include <spdnet/net/channel_collector.h>
+#include <spdnet/net/loop_metrics.h>
+#include <spdnet/net/detail/impl_linux/epoll_channel.h>
+#include <spdnet/net/detail/impl_linux/epoll_accept_channel.h>
+
+namespace spdnet {
+    namespace net {
+        class task_executor;
+
+        namespace detail {
+            // linux下epoll和io_uring两种后端的公共接口 ，由service_thread在运行时选择具体实现
+            class io_impl : public spdnet::base::noncopyable, public std::enable_shared_from_this<io_impl> {
+            public:
+                io_impl(std::shared_ptr<task_executor> task_executor,
+                        std::shared_ptr<channel_collector> channel_collector,
+                        std::function<void(sock_t)> &&socket_close_notify_cb)
+                        : task_executor_(task_executor),
+                          channel_collector_(channel_collector),
+                          socket_close_notify_cb_(std::move(socket_close_notify_cb)) {
+
+                }
+
+                virtual ~io_impl() noexcept {
+                    if (arena_ != nullptr)
+                        arena_->release();
+                }
+
+                virtual io_backend backend() const = 0;
+
+                virtual bool on_socket_enter(socket_data::ptr data) = 0;
+
+                // 等待并处理io事件 , 返回处理的事件数
+                virtual size_t run_once(uint32_t timeout) = 0;
+
+                virtual void post_flush(socket_data *socket_data) = 0;
+
+                virtual void shutdown_socket(socket_data::ptr data) = 0;
+
+                // 立即关闭socket , 从会话表移除并回调断开 , 只在io线程调用
+                virtual void close_socket(socket_data::ptr data) = 0;
+
+                virtual bool start_accept(sock_t listen_fd, accept_channel_impl *channel) = 0;
+
+                virtual bool async_connect(sock_t client_fd, const end_point &addr, channel *channel) = 0;
+
+                virtual void unlink_channel(sock_t fd) = 0;
+
+                virtual void wakeup() = 0;
+
+                // 是否支持把socket迁移到另一个io线程
+                virtual bool support_migration() const {
+                    return false;
+                }
+
+                // 在本线程解除socket的关联 , 未读和未发送的数据都留在socket_data里
+                virtual bool detach_socket(socket_data::ptr data) {
+                    (void) data;
+                    return false;
+                }
+
+                // 在本线程重新关联detach_socket解除的socket , 失败时关闭socket
+                virtual bool attach_socket(socket_data::ptr data) {
+                    (void) data;
+                    return false;
+                }
+
+                // 事件循环退出时在io线程调用 , 释放还在等待内核的资源
+                virtual void on_loop_exit() {}
+
+                // 最近一次从io等待中返回的时间 , 之后到本轮循环结束都算作忙碌
+                std::chrono::steady_clock::time_point last_wakeup_time() const {
+                    return wakeup_time_;
+                }
+
+                // 本线程的运行统计 , 只在io线程更新
+                loop_metrics &metrics() {
+                    return metrics_;
+                }
+
+                const loop_metrics &metrics() const {
+                    return metrics_;
+                }
+
+                // 设置后本线程的buffer优先从大页内存池分配 , 只能在线程启动前调用
+                void set_buffer_arena(spdnet::base::hugepage_arena *arena) {
+                    if (arena_ != nullptr)
+                        arena_->release();
+                    arena_ = arena;
+                }
+
+                // 在io线程里调用 , 之后本线程从arena无锁分配 ; 其它线程的分配改用buffer_pool
+                void bind_buffer_arena(bool bind) {
+                    spdnet::base::hugepage_arena::set_thread_arena(bind ? arena_ : nullptr);
+                }
+
+                spdnet::base::buffer *alloc_buffer(size_t size) {
+                    if (arena_ != nullptr) {
+                        spdnet::base::buffer *buffer = arena_->alloc_buffer(size);
+                        if (SPDNET_PREDICT_TRUE(buffer != nullptr))
+                            return buffer;
+                    }
+                    return spdnet::base::buffer_pool::instance().alloc_buffer(size);
+                }
+
+                void recycle_buffer(spdnet::base::buffer *buffer) {
+                    spdnet::base::buffer_pool::instance().recycle_buffer(buffer);
+                }
+
+            protected:
+                void mark_wakeup() {
+                    wakeup_time_ = std::chrono::steady_clock::now();
+                }
+
+            protected:
+                std::chrono::steady_clock::time_point wakeup_time_;
+                loop_metrics metrics_;
+                spdnet::base::hugepage_arena *arena_{nullptr};
+                std::shared_ptr<task_executor> task_executor_;
+                std::shared_ptr<channel_collector> channel_collector_;
+                std::function<void(sock_t)> socket_close_notify_cb_;
+            };
+
+            using io_object_impl_type = io_impl;
+        }
+    }
+}
+
+#endif  // SPDNET_NET_IO_IMPL_H_
@@ -0,0 +1,159 @@
+#ifndef SPDNET_NET_IO_URING_IMPL_H_
+#define SPDNET_NET_IO_URING_IMPL_H_
+
+#include <spdnet/base/platform.h>
+
+#if defined(SPDNET_HAS_IO_URING)
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/net/socket_data.h>
+#include <spdnet/net/end_point.h>
+#include <spdnet/net/channel_collector.h>
+#include <spdnet/net/detail/impl_linux/io_impl.h>
+#include <spdnet/net/detail/impl_linux/io_uring_ring.h>
+#include <spdnet/net/detail/impl_linux/epoll_wakeup_channel.h>
+
+namespace spdnet {
+    namespace net {
+        class task_executor;
+
+        namespace detail {
+            class channel;
+
+            /*
+             * 基于io_uring的完成式后端 。recvmsg、sendmsg、accept、connect都以sqe的形式投递 ,
+             * 每轮循环只调用一次io_uring_enter完成提交和等待 , EAGAIN由内核内部处理 , 不再需要epoll_ctl 。
+             * 除wakeup外所有sqe都只在io线程里准备 , 其它线程的请求通过task_executor转投 。
+            **/
+            class io_uring_impl : public io_impl {
+            public:
+                friend class io_uring_socket_channel;
+
+                static constexpr uint32_t ring_entries = 1024;
+                static constexpr size_t max_pending_accept = 8;
+
+                // 探测内核是否支持本后端所需的特性和操作 , 结果只计算一次
+                static bool is_supported();
+
+                explicit io_uring_impl(std::shared_ptr<task_executor> task_executor,
+                                       std::shared_ptr<channel_collector> channel_collector,
+                                       std::function<void(sock_t)> &&socket_close_notify_cb);
+
+                virtual ~io_uring_impl() noexcept;
+
+                io_backend backend() const override { return io_backend::io_uring; }
+
+                bool on_socket_enter(socket_data::ptr data) override;
+
+                size_t run_once(uint32_t timeout) override;
+
+                void post_flush(socket_data *socket_data) override;
+
+                void shutdown_socket(socket_data::ptr data) override;
+
+                void close_socket(socket_data::ptr data) override;
+
+                bool start_accept(sock_t listen_fd, accept_channel_impl *channel) override;
+
+                bool async_connect(sock_t client_fd, const end_point &addr, channel *channel) override;
+
+                // 取消该socket在途的accept和connect , 之后的完成事件不再回调channel
+                void unlink_channel(sock_t fd) override;
+
+                void wakeup() override;
+
+                // 不再处理完成事件 , 关闭ring让内核取消在途的操作 , 在途的accept不再占用监听socket
+                void on_loop_exit() override;
+
+            private:
+                class wakeup_op : public io_uring_op {
+                public:
+                    explicit wakeup_op(io_uring_impl &impl) : impl_(impl) {}
+
+                    void do_complete(int32_t res) override;
+
+                private:
+                    io_uring_impl &impl_;
+                };
+
+                class accept_op : public io_uring_op {
+                public:
+                    accept_op(io_uring_impl &impl, sock_t listen_fd, accept_channel_impl *channel)
+                            : impl_(impl), listen_fd_(listen_fd), channel_(channel) {}
+
+                    void arm();
+
+                    void cancel();
+
+                    bool is_cancelled() const { return channel_ == nullptr; }
+
+                    sock_t listen_fd() const { return listen_fd_; }
+
+                    void do_complete(int32_t res) override;
+
+                private:
+                    io_uring_impl &impl_;
+                    sock_t listen_fd_;
+                    accept_channel_impl *channel_;
+                };
+
+                class connect_op : public io_uring_op {
+                public:
+                    connect_op(io_uring_impl &impl, sock_t fd, const end_point &addr, channel *channel)
+                            : impl_(impl), fd_(fd), addr_(addr), channel_(channel) {}
+
+                    void cancel();
+
+                    void do_complete(int32_t res) override;
+
+                    io_uring_impl &impl_;
+                    sock_t fd_;
+                    end_point addr_;
+                    channel *channel_;
+                };
+
+                io_uring_sqe *get_sqe() {
+                    return ring_.get_sqe();
+                }
+
+                void arm_wakeup();
+
+                // 重新投递上一轮因为sq满且提交失败而没能投递的wakeup和accept
+                void retry_pending_arms();
+
+                bool has_pending_arms() const {
+                    return !wakeup_armed_ || !pending_accept_ops_.empty();
+                }
+
+                void cancel_op(const io_uring_op *op);
+
+                void release_accept_op(const accept_op *op);
+
+                void release_connect_op(const connect_op *op);
+
+            private:
+                io_uring_ring ring_;
+                epoll_wakeup_channel wakeup_;
+                wakeup_op wakeup_op_;
+                bool wakeup_armed_{false};
+                std::vector<std::unique_ptr<accept_op>> accept_ops_;
+                // 没能投递的accept , 不重试的话这个accept就不再接受连接
+                std::vector<accept_op *> pending_accept_ops_;
+                // 已投递、还没完成的connect , 发起方放弃连接时在unlink_channel里取消
+                std::vector<std::unique_ptr<connect_op>> connect_ops_;
+                // on_loop_exit之后为true , 可在任意线程读取
+                std::atomic_bool exited_{false};
+            };
+        }
+    }
+}
+
+#include <spdnet/net/detail/impl_linux/io_uring_impl.ipp>
+
+#endif // SPDNET_HAS_IO_URING
+
+#endif  // SPDNET_NET_IO_URING_IMPL_H_
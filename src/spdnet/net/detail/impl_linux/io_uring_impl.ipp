@@ -0,0 +1,281 @@
+#ifndef SPDNET_NET_IO_URING_IMPL_IPP_
+#define SPDNET_NET_IO_URING_IMPL_IPP_
+
+#include <spdnet/net/detail/impl_linux/io_uring_impl.h>
+#include <memory>
+#include <algorithm>
+#include <cassert>
+#include <poll.h>
+#include <spdnet/base/platform.h>
+#include <spdnet/net/exception.h>
+#include <spdnet/net/task_executor.h>
+#include <spdnet/net/detail/impl_linux/io_uring_socket_channel.h>
+
+namespace spdnet {
+    namespace net {
+        namespace detail {
+            bool io_uring_impl::is_supported() {
+                static const bool supported = []() {
+                    io_uring_ring ring(2);
+                    if (!ring.valid())
+                        return false;
+                    for (uint8_t op : {IORING_OP_RECVMSG, IORING_OP_SENDMSG, IORING_OP_ACCEPT, IORING_OP_CONNECT,
+                                       IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL}) {
+                        if (!ring.is_op_supported(op))
+                            return false;
+                    }
+                    return true;
+                }();
+                return supported;
+            }
+
+            io_uring_impl::io_uring_impl(std::shared_ptr<task_executor> task_executor,
+                                         std::shared_ptr<channel_collector> channel_collector,
+                                         std::function<void(sock_t)> &&socket_close_notify_cb)
+                    : io_impl(task_executor, channel_collector, std::move(socket_close_notify_cb)),
+                      ring_(ring_entries),
+                      wakeup_op_(*this) {
+                if (!ring_.valid())
+                    throw spdnet_exception(std::string("io_uring setup error : ") + std::to_string(current_errno()));
+                arm_wakeup();
+            }
+
+            io_uring_impl::~io_uring_impl() noexcept {
+                // 关闭ring时内核会取消所有在途的操作
+            }
+
+            void io_uring_impl::arm_wakeup() {
+                io_uring_sqe *sqe = get_sqe();
+                // 没有挂上poll时其它线程投递task唤醒不了io线程 , 在run_once里重试
+                wakeup_armed_ = sqe != nullptr;
+                if (SPDNET_PREDICT_FALSE(sqe == nullptr))
+                    return;
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->fd = wakeup_.eventfd();
+                sqe->poll32_events = POLLIN;
+                sqe->user_data = reinterpret_cast<uint64_t>(static_cast<io_uring_op *>(&wakeup_op_));
+            }
+
+            void io_uring_impl::wakeup_op::do_complete(int32_t res) {
+                (void) res;
+                // 读空eventfd后重新挂上poll
+                static_cast<channel &>(impl_.wakeup_).on_recv();
+                impl_.arm_wakeup();
+            }
+
+            void io_uring_impl::accept_op::arm() {
+                io_uring_sqe *sqe = impl_.get_sqe();
+                if (SPDNET_PREDICT_FALSE(sqe == nullptr)) {
+                    impl_.pending_accept_ops_.push_back(this);
+                    return;
+                }
+                sqe->opcode = IORING_OP_ACCEPT;
+                sqe->fd = listen_fd_;
+                sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+                sqe->user_data = reinterpret_cast<uint64_t>(static_cast<io_uring_op *>(this));
+            }
+
+            void io_uring_impl::accept_op::cancel() {
+                channel_ = nullptr;
+                impl_.cancel_op(this);
+            }
+
+            void io_uring_impl::accept_op::do_complete(int32_t res) {
+                if (channel_ == nullptr) {
+                    // 已解除关联 , 取消前可能刚好完成了一次accept
+                    if (res >= 0)
+                        socket_ops::close_socket(res);
+                    impl_.release_accept_op(this);
+                    return;
+                }
+                if (res >= 0) {
+                    channel_->on_accepted(res);
+                } else if (res == -ECANCELED) {
+                    return;
+                } else if (res != -EAGAIN && res != -EINTR) {
+                    channel_->on_accept_failed(-res);
+                }
+                arm();
+            }
+
+            void io_uring_impl::connect_op::cancel() {
+                channel_ = nullptr;
+                impl_.cancel_op(this);
+            }
+
+            void io_uring_impl::connect_op::do_complete(int32_t res) {
+                channel *ch = channel_;
+                // 先释放 , 回调里会解除关联 , 也可能发起新的连接
+                impl_.release_connect_op(this);
+                // 已解除关联 , context可能已经释放 , socket由发起方关闭
+                if (ch == nullptr)
+                    return;
+                // connect_context在on_send里会再用SO_ERROR确认连接结果
+                if (res == 0)
+                    ch->on_send();
+                else
+                    ch->on_close();
+            }
+
+            void io_uring_impl::retry_pending_arms() {
+                if (!wakeup_armed_)
+                    arm_wakeup();
+                if (pending_accept_ops_.empty())
+                    return;
+                std::vector<accept_op *> ops;
+                ops.swap(pending_accept_ops_);
+                for (auto op : ops) {
+                    // 等待重试期间已解除关联 , 没有在途的sqe , 直接释放
+                    if (op->is_cancelled())
+                        release_accept_op(op);
+                    else
+                        op->arm();
+                }
+            }
+
+            void io_uring_impl::cancel_op(const io_uring_op *op) {
+                io_uring_sqe *sqe = get_sqe();
+                if (SPDNET_PREDICT_FALSE(sqe == nullptr))
+                    return;
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->addr = reinterpret_cast<uint64_t>(op);
+                sqe->user_data = 0;
+            }
+
+            void io_uring_impl::release_accept_op(const accept_op *op) {
+                for (auto iter = accept_ops_.begin(); iter != accept_ops_.end(); ++iter) {
+                    if (iter->get() == op) {
+                        accept_ops_.erase(iter);
+                        return;
+                    }
+                }
+            }
+
+            void io_uring_impl::release_connect_op(const connect_op *op) {
+                for (auto iter = connect_ops_.begin(); iter != connect_ops_.end(); ++iter) {
+                    if (iter->get() == op) {
+                        connect_ops_.erase(iter);
+                        return;
+                    }
+                }
+            }
+
+            void io_uring_impl::unlink_channel(sock_t fd) {
+                // ring已经关闭 , 在途的操作都已取消 , 投递的task也不会再执行
+                if (exited_.load(std::memory_order_acquire))
+                    return;
+                auto impl = std::static_pointer_cast<io_uring_impl>(shared_from_this());
+                task_executor_->post([impl, fd]() {
+                    for (auto &op : impl->accept_ops_) {
+                        if (op->listen_fd() == fd)
+                            op->cancel();
+                    }
+                    for (auto &op : impl->connect_ops_) {
+                        if (op->fd_ == fd && op->channel_ != nullptr)
+                            op->cancel();
+                    }
+                });
+            }
+
+            void io_uring_impl::post_flush(socket_data *socket_data) {
+                task_executor_->post([socket_data]() {
+                    socket_data->clear_flush_scheduled();
+                    if (socket_data->is_can_write_) {
+                        static_cast<io_uring_socket_channel *>(socket_data->channel_.get())->flush_buffer();
+                    }
+                }, false);
+            }
+
+            bool io_uring_impl::start_accept(sock_t listen_fd, accept_channel_impl *ch) {
+                auto impl = std::static_pointer_cast<io_uring_impl>(shared_from_this());
+                task_executor_->post([impl, listen_fd, ch]() {
+                    for (size_t i = 0; i < max_pending_accept; i++) {
+                        impl->accept_ops_.emplace_back(new accept_op(*impl, listen_fd, ch));
+                        impl->accept_ops_.back()->arm();
+                    }
+                });
+                return true;
+            }
+
+            bool io_uring_impl::async_connect(sock_t client_fd, const end_point &addr, channel *ch) {
+                auto impl = std::static_pointer_cast<io_uring_impl>(shared_from_this());
+                auto op = new connect_op(*this, client_fd, addr, ch);
+                task_executor_->post([impl, op]() {
+                    impl->connect_ops_.emplace_back(op);
+                    io_uring_sqe *sqe = impl->get_sqe();
+                    if (SPDNET_PREDICT_FALSE(sqe == nullptr)) {
+                        op->do_complete(-EAGAIN);
+                        return;
+                    }
+                    sqe->opcode = IORING_OP_CONNECT;
+                    sqe->fd = op->fd_;
+                    sqe->addr = reinterpret_cast<uint64_t>(op->addr_.socket_addr());
+                    sqe->off = op->addr_.socket_addr_len();
+                    sqe->user_data = reinterpret_cast<uint64_t>(static_cast<io_uring_op *>(op));
+                });
+                return true;
+            }
+
+            void io_uring_impl::wakeup() {
+                wakeup_.wakeup();
+            }
+
+            void io_uring_impl::on_loop_exit() {
+                exited_.store(true, std::memory_order_release);
+                ring_.close();
+            }
+
+            void io_uring_impl::close_socket(socket_data::ptr data) {
+                if (data->has_closed_)
+                    return;
+
+                // 在途的recv/sendmsg持有channel的引用 , 取消后在完成事件里释放
+                channel_collector_->put_channel(data->channel_);
+                static_cast<io_uring_socket_channel *>(data->channel_.get())->cancel_ops();
+
+                socket_close_notify_cb_(data->sock_fd());
+
+                data->drop_pending_send_bytes(*this);
+                data->close();
+            }
+
+            void io_uring_impl::shutdown_socket(socket_data::ptr data) {
+                if (data->has_closed_)
+                    return;
+                ::shutdown(data->sock_fd(), SHUT_WR);
+                data->is_can_write_ = false;
+            }
+
+            bool io_uring_impl::on_socket_enter(socket_data::ptr data) {
+                auto impl = std::static_pointer_cast<io_uring_impl>(shared_from_this());
+                auto channel = std::make_shared<io_uring_socket_channel>(impl, data);
+                data->channel_ = channel;
+                // 会话还没加入service_thread , 失败时不能走close_socket的关闭通知 , 直接关闭
+                if (SPDNET_PREDICT_FALSE(!channel->try_start_recv())) {
+                    data->close();
+                    return false;
+                }
+                return true;
+            }
+
+            size_t io_uring_impl::run_once(uint32_t timeout) {
+                if (SPDNET_PREDICT_FALSE(has_pending_arms())) {
+                    // 上一轮的完成事件已经处理 , cq有了空间 ; 仍然失败时不长时间阻塞 , 尽快再试
+                    retry_pending_arms();
+                    if (has_pending_arms())
+                        timeout = (std::min)(timeout, 1u);
+                }
+                ring_.submit_and_wait(timeout);
+                mark_wakeup();
+                return ring_.for_each_cqe([](uint64_t user_data, int32_t res) {
+                    if (user_data == 0)
+                        return;
+                    reinterpret_cast<io_uring_op *>(user_data)->do_complete(res);
+                });
+            }
+        }
+    }
+}
+
+#endif //SPDNET_NET_IO_URING_IMPL_IPP_
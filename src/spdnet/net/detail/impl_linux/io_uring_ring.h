@@ -0,0 +1,225 @@
+#ifndef SPDNET_NET_IO_URING_RING_H_
+#define SPDNET_NET_IO_URING_RING_H_
+
+#include <spdnet/base/platform.h>
+
+#if defined(SPDNET_HAS_IO_URING)
+
+#include <ctime>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <spdnet/base/noncopyable.h>
+
+namespace spdnet {
+    namespace net {
+        namespace detail {
+            // 投递到io_uring的操作 ，sqe的user_data即为该对象的地址
+            class io_uring_op {
+            public:
+                virtual ~io_uring_op() noexcept {}
+
+                virtual void do_complete(int32_t res) = 0;
+            };
+
+            // 直接基于系统调用的io_uring封装 ，不依赖liburing
+            class io_uring_ring : public spdnet::base::noncopyable {
+            public:
+                // 以下特性都是必须的 , 内核缺失时service_thread回退到epoll
+                static constexpr uint32_t required_features =
+                        IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+                explicit io_uring_ring(uint32_t entries) {
+                    struct io_uring_params params;
+                    memset(&params, 0, sizeof(params));
+                    ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                    if (ring_fd_ < 0) {
+                        ring_fd_ = -1;
+                        return;
+                    }
+                    if ((params.features & required_features) != required_features || !map_rings(params)) {
+                        release();
+                    }
+                }
+
+                ~io_uring_ring() {
+                    release();
+                }
+
+                bool valid() const { return ring_fd_ >= 0; }
+
+                // 内核取消所有在途的操作 , 之后get_sqe返回nullptr
+                void close() {
+                    release();
+                }
+
+                int ring_fd() const { return ring_fd_; }
+
+                bool is_op_supported(uint8_t opcode) const {
+                    constexpr size_t max_ops = 256;
+                    alignas(io_uring_probe) char storage[sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op)];
+                    memset(storage, 0, sizeof(storage));
+                    auto probe = reinterpret_cast<io_uring_probe *>(storage);
+                    if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, max_ops) < 0)
+                        return false;
+                    if (opcode > probe->last_op)
+                        return false;
+                    return (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+                }
+
+                // 返回一个清零的sqe , 队列满时先把已准备好的sqe提交给内核
+                io_uring_sqe *get_sqe() {
+                    if (SPDNET_PREDICT_FALSE(sqes_ == nullptr))
+                        return nullptr;
+                    uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+                    if (SPDNET_PREDICT_FALSE(sqe_tail_ - head >= sq_entries_)) {
+                        submit();
+                        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+                        if (sqe_tail_ - head >= sq_entries_)
+                            return nullptr;
+                    }
+                    io_uring_sqe *sqe = &sqes_[sqe_tail_ & sq_mask_];
+                    sqe_tail_++;
+                    memset(sqe, 0, sizeof(*sqe));
+                    return sqe;
+                }
+
+                int submit() {
+                    uint32_t to_submit = flush_sq();
+                    if (to_submit == 0)
+                        return 0;
+                    return enter(to_submit, 0, 0, nullptr, 0);
+                }
+
+                // 一次系统调用完成提交和等待 , timeout_ms内没有完成事件时返回
+                int submit_and_wait(uint32_t timeout_ms) {
+                    uint32_t to_submit = flush_sq();
+                    if (cq_ready() > 0)
+                        return to_submit > 0 ? enter(to_submit, 0, 0, nullptr, 0) : 0;
+
+                    struct __kernel_timespec ts;
+                    ts.tv_sec = timeout_ms / 1000;
+                    ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+                    struct io_uring_getevents_arg arg;
+                    memset(&arg, 0, sizeof(arg));
+                    arg.ts = reinterpret_cast<uint64_t>(&ts);
+                    return enter(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+                }
+
+                uint32_t cq_ready() const {
+                    return __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) - *cq_head_;
+                }
+
+                // 处理当前所有的完成事件 ，回调里可以继续获取sqe
+                template<typename Func>
+                uint32_t for_each_cqe(Func &&func) {
+                    uint32_t head = *cq_head_;
+                    uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+                    uint32_t count = 0;
+                    while (head != tail) {
+                        const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+                        uint64_t user_data = cqe.user_data;
+                        int32_t res = cqe.res;
+                        head++;
+                        count++;
+                        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                        func(user_data, res);
+                        if (head == tail)
+                            tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+                    }
+                    return count;
+                }
+
+            private:
+                bool map_rings(const io_uring_params &params) {
+                    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+                    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                    ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+                    ring_ptr_ = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                       ring_fd_, IORING_OFF_SQ_RING);
+                    if (ring_ptr_ == MAP_FAILED) {
+                        ring_ptr_ = nullptr;
+                        return false;
+                    }
+                    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+                    void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        ring_fd_, IORING_OFF_SQES);
+                    if (sqes == MAP_FAILED)
+                        return false;
+                    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+                    char *ring = static_cast<char *>(ring_ptr_);
+                    sq_head_ = reinterpret_cast<uint32_t *>(ring + params.sq_off.head);
+                    sq_tail_ = reinterpret_cast<uint32_t *>(ring + params.sq_off.tail);
+                    sq_mask_ = *reinterpret_cast<uint32_t *>(ring + params.sq_off.ring_mask);
+                    sq_entries_ = params.sq_entries;
+                    uint32_t *sq_array = reinterpret_cast<uint32_t *>(ring + params.sq_off.array);
+                    for (uint32_t i = 0; i < sq_entries_; i++)
+                        sq_array[i] = i;
+
+                    cq_head_ = reinterpret_cast<uint32_t *>(ring + params.cq_off.head);
+                    cq_tail_ = reinterpret_cast<uint32_t *>(ring + params.cq_off.tail);
+                    cq_mask_ = *reinterpret_cast<uint32_t *>(ring + params.cq_off.ring_mask);
+                    cqes_ = reinterpret_cast<io_uring_cqe *>(ring + params.cq_off.cqes);
+
+                    sqe_tail_ = *sq_tail_;
+                    return true;
+                }
+
+                // 返回内核尚未消费的sqe数量 , 包含上次提交中途出错而残留的部分
+                uint32_t flush_sq() {
+                    if (*sq_tail_ != sqe_tail_)
+                        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+                    return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+                }
+
+                int enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags, void *arg, size_t arg_size) {
+                    int ret;
+                    do {
+                        ret = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                                                         flags, arg, arg_size));
+                    } while (ret < 0 && errno == EINTR && min_complete == 0);
+                    return ret;
+                }
+
+                void release() {
+                    if (sqes_ != nullptr) {
+                        ::munmap(sqes_, sqes_size_);
+                        sqes_ = nullptr;
+                    }
+                    if (ring_ptr_ != nullptr) {
+                        ::munmap(ring_ptr_, ring_size_);
+                        ring_ptr_ = nullptr;
+                    }
+                    if (ring_fd_ >= 0) {
+                        ::close(ring_fd_);
+                        ring_fd_ = -1;
+                    }
+                }
+
+            private:
+                int ring_fd_{-1};
+                void *ring_ptr_{nullptr};
+                size_t ring_size_{0};
+                io_uring_sqe *sqes_{nullptr};
+                size_t sqes_size_{0};
+
+                uint32_t *sq_head_{nullptr};
+                uint32_t *sq_tail_{nullptr};
+                uint32_t sq_mask_{0};
+                uint32_t sq_entries_{0};
+                uint32_t sqe_tail_{0};
+
+                uint32_t *cq_head_{nullptr};
+                uint32_t *cq_tail_{nullptr};
+                uint32_t cq_mask_{0};
+                io_uring_cqe *cqes_{nullptr};
+            };
+        }
+    }
+}
+
+#endif // SPDNET_HAS_IO_URING
+
+#endif  // SPDNET_NET_IO_URING_RING_H_
@@ -0,0 +1,280 @@
+#ifndef SPDNET_NET_IO_URING_SOCKET_CHANNEL_H_
+#define SPDNET_NET_IO_URING_SOCKET_CHANNEL_H_
+
+#include <spdnet/base/platform.h>
+
+#if defined(SPDNET_HAS_IO_URING)
+
+#include <vector>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/net/detail/impl_linux/io_uring_impl.h>
+#include <spdnet/net/detail/impl_linux/epoll_channel.h>
+#include <spdnet/net/socket_data.h>
+
+namespace spdnet {
+    namespace net {
+        namespace detail {
+            class io_uring_socket_channel
+                    : public channel, public std::enable_shared_from_this<io_uring_socket_channel> {
+            public:
+                friend class io_uring_impl;
+
+                static constexpr size_t max_iovec = 1024;
+                static constexpr size_t max_recv_iovec = 16;
+
+                io_uring_socket_channel(std::shared_ptr<io_uring_impl> impl, socket_data::ptr data)
+                        : impl_(impl), data_(data), recv_op_(*this), send_op_(*this), poll_out_op_(*this) {
+
+                }
+
+                // 提交recvmsg , sq满时返回false , 由调用方处理
+                bool try_start_recv() {
+                    struct iovec *iov = recv_iov_;
+                    size_t cnt = data_->recv_buffer_.prepare(*impl_, recv_window_, max_recv_iovec,
+                                                             [&iov](char *data, size_t len) {
+                                                                 iov->iov_base = data;
+                                                                 iov->iov_len = len;
+                                                                 iov++;
+                                                             });
+                    recv_len_ = 0;
+                    for (size_t i = 0; i < cnt; i++)
+                        recv_len_ += recv_iov_[i].iov_len;
+
+                    io_uring_sqe *sqe = impl_->get_sqe();
+                    if (SPDNET_PREDICT_FALSE(sqe == nullptr))
+                        return false;
+                    memset(&recv_msg_, 0, sizeof(recv_msg_));
+                    recv_msg_.msg_iov = recv_iov_;
+                    recv_msg_.msg_iovlen = cnt;
+                    sqe->opcode = IORING_OP_RECVMSG;
+                    sqe->fd = data_->sock_fd();
+                    sqe->addr = reinterpret_cast<uint64_t>(&recv_msg_);
+                    sqe->len = 1;
+                    sqe->user_data = reinterpret_cast<uint64_t>(static_cast<io_uring_op *>(&recv_op_));
+                    recv_ref_ = shared_from_this();
+                    return true;
+                }
+
+                void start_recv() {
+                    if (SPDNET_PREDICT_FALSE(!try_start_recv()))
+                        impl_->close_socket(data_);
+                }
+
+                void flush_buffer() {
+                    // 同一时刻只允许一个sendmsg在途 , 完成后会再次调用flush_buffer
+                    if (data_->has_closed_ || send_ref_ != nullptr)
+                        return;
+                    data_->merge_send_packets(*impl_);
+                    // 文件区间没有对应的sqe , 在io线程里直接sendfile , 写满时挂上POLLOUT等待
+                    while (!data_->pending_packet_list_.empty() && data_->pending_packet_list_.front().is_file()) {
+                        if (!send_file_region())
+                            return;
+                    }
+                    if (data_->pending_packet_list_.empty())
+                        return;
+
+                    iov_.clear();
+                    data_->prepare_send_packets(max_iovec, [this](const char *data, size_t len) {
+                        struct iovec vec;
+                        vec.iov_base = const_cast<char *>(data);
+                        vec.iov_len = len;
+                        iov_.push_back(vec);
+                    });
+
+                    io_uring_sqe *sqe = impl_->get_sqe();
+                    if (SPDNET_PREDICT_FALSE(sqe == nullptr)) {
+                        impl_->close_socket(data_);
+                        return;
+                    }
+                    data_->trace_send_attempt(*impl_, iov_.size());
+                    memset(&msg_, 0, sizeof(msg_));
+                    msg_.msg_iov = iov_.data();
+                    msg_.msg_iovlen = iov_.size();
+                    sqe->opcode = IORING_OP_SENDMSG;
+                    sqe->fd = data_->sock_fd();
+                    sqe->addr = reinterpret_cast<uint64_t>(&msg_);
+                    sqe->len = 1;
+                    sqe->msg_flags = MSG_NOSIGNAL;
+                    sqe->user_data = reinterpret_cast<uint64_t>(static_cast<io_uring_op *>(&send_op_));
+                    send_ref_ = shared_from_this();
+                }
+
+            private:
+                class recv_op : public io_uring_op {
+                public:
+                    explicit recv_op(io_uring_socket_channel &owner) : owner_(owner) {}
+
+                    void do_complete(int32_t res) override {
+                        owner_.on_recv_complete(res);
+                    }
+
+                private:
+                    io_uring_socket_channel &owner_;
+                };
+
+                class send_op : public io_uring_op {
+                public:
+                    explicit send_op(io_uring_socket_channel &owner) : owner_(owner) {}
+
+                    void do_complete(int32_t res) override {
+                        owner_.on_send_complete(res);
+                    }
+
+                private:
+                    io_uring_socket_channel &owner_;
+                };
+
+                class poll_out_op : public io_uring_op {
+                public:
+                    explicit poll_out_op(io_uring_socket_channel &owner) : owner_(owner) {}
+
+                    void do_complete(int32_t res) override {
+                        owner_.on_poll_out_complete(res);
+                    }
+
+                private:
+                    io_uring_socket_channel &owner_;
+                };
+
+                void on_send() override {}
+
+                void on_recv() override {}
+
+                void on_close() override {
+                    impl_->close_socket(data_);
+                }
+
+                void cancel_ops() {
+                    if (recv_ref_ != nullptr)
+                        impl_->cancel_op(&recv_op_);
+                    if (send_ref_ != nullptr) {
+                        // 在途的可能是sendmsg或POLLOUT , 取消不存在的操作只会得到一个被忽略的完成事件
+                        impl_->cancel_op(&send_op_);
+                        impl_->cancel_op(&poll_out_op_);
+                    }
+                }
+
+                // 返回false表示需要等待可写或socket已关闭
+                bool send_file_region() {
+                    auto &packet = data_->pending_packet_list_.front();
+                    off_t offset = packet.file_offset_;
+                    data_->trace_send_attempt(*impl_, 1);
+                    ssize_t send_len = ::sendfile(data_->sock_fd(), packet.file_fd_, &offset, packet.length());
+                    impl_->metrics().send_calls.add();
+                    if (send_len > 0) {
+                        data_->remove_sent_packets(*impl_, static_cast<size_t>(send_len));
+                        return !data_->has_closed_;
+                    }
+                    if (send_len < 0 && (errno == EAGAIN || errno == EINTR)) {
+                        impl_->metrics().eagain.add();
+                        io_uring_sqe *sqe = impl_->get_sqe();
+                        if (SPDNET_PREDICT_TRUE(sqe != nullptr)) {
+                            sqe->opcode = IORING_OP_POLL_ADD;
+                            sqe->fd = data_->sock_fd();
+                            sqe->poll32_events = POLLOUT;
+                            sqe->user_data = reinterpret_cast<uint64_t>(static_cast<io_uring_op *>(&poll_out_op_));
+                            send_ref_ = shared_from_this();
+                            return false;
+                        }
+                    }
+                    // 出错 , 或文件比指定的区间短
+                    impl_->close_socket(data_);
+                    return false;
+                }
+
+                void on_poll_out_complete(int32_t res) {
+                    auto self = std::move(send_ref_);
+                    if (data_->has_closed_ || res == -ECANCELED)
+                        return;
+                    if (SPDNET_PREDICT_FALSE(res < 0)) {
+                        impl_->close_socket(data_);
+                        return;
+                    }
+                    if (data_->is_can_write_)
+                        flush_buffer();
+                }
+
+                void on_recv_complete(int32_t res) {
+                    // 在途操作持有channel的引用 , 完成时才释放
+                    auto self = std::move(recv_ref_);
+                    if (data_->has_closed_)
+                        return;
+                    impl_->metrics().on_recv(res > 0 ? static_cast<size_t>(res) : 0);
+                    if (res == -EAGAIN || res == -EINTR) {
+                        impl_->metrics().eagain.add();
+                        start_recv();
+                        return;
+                    }
+                    if (res <= 0) {
+                        impl_->close_socket(data_);
+                        return;
+                    }
+
+                    auto &recv_buffer = data_->recv_buffer_;
+                    recv_buffer.commit(static_cast<size_t>(res));
+                    if (SPDNET_PREDICT_FALSE(!data_->deliver_recv_data(*impl_))) {
+                        impl_->close_socket(data_);
+                        return;
+                    }
+                    if (data_->has_closed_)
+                        return;
+
+                    // 读满说明还有大量数据 , 扩大下一次准备的空间 ; 否则回到一个块
+                    if (static_cast<size_t>(res) == recv_len_) {
+                        if (recv_window_ < data_->max_recv_buffer_size_)
+                            recv_window_ *= 2;
+                    } else {
+                        recv_window_ = spdnet::base::chain_buffer::block_size;
+                    }
+                    recv_buffer.shrink(*impl_);
+
+                    start_recv();
+                }
+
+                void on_send_complete(int32_t res) {
+                    auto self = std::move(send_ref_);
+                    if (data_->has_closed_)
+                        return;
+                    impl_->metrics().send_calls.add();
+                    if (SPDNET_PREDICT_FALSE(res < 0)) {
+                        if (res == -EAGAIN || res == -EINTR) {
+                            impl_->metrics().eagain.add();
+                            flush_buffer();
+                        } else {
+                            impl_->close_socket(data_);
+                        }
+                        return;
+                    }
+
+                    data_->remove_sent_packets(*impl_, static_cast<size_t>(res));
+
+                    if (data_->is_can_write_)
+                        flush_buffer();
+                }
+
+            private:
+                std::shared_ptr<io_uring_impl> impl_;
+                socket_data::ptr data_;
+                recv_op recv_op_;
+                send_op send_op_;
+                poll_out_op poll_out_op_;
+                std::shared_ptr<io_uring_socket_channel> recv_ref_;
+                std::shared_ptr<io_uring_socket_channel> send_ref_;
+                std::vector<struct iovec> iov_;
+                struct msghdr msg_;
+                struct iovec recv_iov_[max_recv_iovec];
+                struct msghdr recv_msg_;
+                size_t recv_len_{0};
+                size_t recv_window_{spdnet::base::chain_buffer::block_size};
+            };
+
+        }
+    }
+
+}
+
+#endif // SPDNET_HAS_IO_URING
+
+#endif  // SPDNET_NET_IO_URING_SOCKET_CHANNEL_H_
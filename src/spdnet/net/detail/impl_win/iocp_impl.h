@@ -2,6 +2,7 @@
 #define SPDNET_NET_IOCP_IMPL_H_
 
 #include <thread>
+#include <chrono>
 #include <mutex>
 #include <vector>
 #include <atomic>
@@ -12,7 +13,9 @@
 #include <spdnet/base/buffer.h>
 #include <spdnet/net/socket_data.h>
 #include <spdnet/net/end_point.h>
+#include <spdnet/net/io_backend.h>
 #include <spdnet/base/buffer_pool.h>
+#include <spdnet/net/loop_metrics.h>
 #include <spdnet/net/detail/impl_win/iocp_wakeup_channel.h>
 #include <spdnet/net/detail/impl_win/iocp_accept_channel.h>
 
@@ -37,11 +40,13 @@ namespace spdnet {
 
                 inline virtual ~iocp_impl() noexcept;
 
+                io_backend backend() const { return io_backend::iocp; }
+
                 inline bool on_socket_enter(socket_data::ptr data);
 
                 inline void post_flush(socket_data *data);
 
-                inline void run_once(uint32_t timeout);
+                inline size_t run_once(uint32_t timeout);
 
                 inline bool start_accept(sock_t listen_fd, iocp_accept_channel *channel);
 
@@ -49,23 +54,36 @@ namespace spdnet {
 
                 inline void shutdown_socket(socket_data::ptr data);
 
+                inline void close_socket(socket_data::ptr data);
+
                 inline void wakeup();
 
+                // 最近一次从io等待中返回的时间 , 之后到本轮循环结束都算作忙碌
+                std::chrono::steady_clock::time_point last_wakeup_time() const {
+                    return wakeup_time_;
+                }
+
+                loop_metrics &metrics() {
+                    return metrics_;
+                }
+
+                const loop_metrics &metrics() const {
+                    return metrics_;
+                }
+
                 spdnet::base::buffer *alloc_buffer(size_t size) {
-                    return buffer_pool_.alloc_buffer(size);
+                    return spdnet::base::buffer_pool::instance().alloc_buffer(size);
                 }
 
                 void recycle_buffer(spdnet::base::buffer *buffer) {
-                    buffer_pool_.recycle_buffer(buffer);
+                    spdnet::base::buffer_pool::instance().recycle_buffer(buffer);
                 }
 
-            private:
-                inline void close_socket(socket_data::ptr data);
-
             private:
                 HANDLE handle_;
+                std::chrono::steady_clock::time_point wakeup_time_;
+                loop_metrics metrics_;
                 iocp_wakeup_channel wakeup_op_;
-                spdnet::base::buffer_pool buffer_pool_;
                 std::atomic<void *> connect_ex_{nullptr};
                 std::shared_ptr<task_executor> task_executor_;
                 std::shared_ptr<channel_collector> channel_collector_;
@@ -62,6 +62,7 @@ namespace spdnet {
 
                 socket_close_notify_cb_(data->sock_fd());
 
+                data->drop_pending_send_bytes(*this);
                 data->close();
             }
 
@@ -133,7 +134,9 @@ namespace spdnet {
                 ::PostQueuedCompletionStatus(handle_,0,0, (LPOVERLAPPED)wakeup_op_.get());
             }
             */
-            void iocp_impl::run_once(uint32_t timeout) {
+            size_t iocp_impl::run_once(uint32_t timeout) {
+                bool first_wait = true;
+                size_t num_events = 0;
                 for (;;) {
                     DWORD bytes_transferred = 0;
                     ULONG_PTR completion_key = 0;
@@ -142,11 +145,16 @@ namespace spdnet {
                     BOOL ok = ::GetQueuedCompletionStatus(handle_, &bytes_transferred, &completion_key, &overlapped,
                                                           timeout);
                     DWORD last_error = ::GetLastError();
+                    if (first_wait) {
+                        wakeup_time_ = std::chrono::steady_clock::now();
+                        first_wait = false;
+                    }
 
                     if (overlapped) {
                         channel *op = static_cast<channel *>(overlapped);
                         op->do_complete((size_t) bytes_transferred,
                                         std::error_code(last_error, std::system_category()));
+                        num_events++;
 
                     } else if (!ok) {
                         break;
@@ -156,6 +164,7 @@ namespace spdnet {
                 }
 
                 // del_channel_list_.clear();
+                return num_events;
             }
 
         }
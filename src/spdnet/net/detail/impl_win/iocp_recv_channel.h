@@ -18,14 +18,25 @@ namespace spdnet {
 
                 }
 
+                static constexpr size_t max_recv_buf = 16;
+
                 void start_recv() {
-                    buf_.len = data_->recv_buffer_.get_write_valid_count();
-                    buf_.buf = data_->recv_buffer_.get_write_ptr();
+                    WSABUF *buf = recv_buf_;
+                    size_t cnt = data_->recv_buffer_.prepare(*io_impl_, recv_window_, max_recv_buf,
+                                                             [&buf](char *data, size_t len) {
+                                                                 buf->buf = data;
+                                                                 buf->len = static_cast<ULONG>(len);
+                                                                 buf++;
+                                                             });
+                    recv_len_ = 0;
+                    for (size_t i = 0; i < cnt; i++)
+                        recv_len_ += recv_buf_[i].len;
 
                     DWORD bytes_transferred = 0;
                     DWORD recv_flags = 0;
                     reset();
-                    int result = ::WSARecv(data_->sock_fd(), &buf_, 1, &bytes_transferred, &recv_flags, (LPOVERLAPPED)
+                    int result = ::WSARecv(data_->sock_fd(), recv_buf_, static_cast<DWORD>(cnt), &bytes_transferred,
+                                           &recv_flags, (LPOVERLAPPED)
                     this, 0);
                     DWORD last_error = ::WSAGetLastError();
                     if (result != 0 && last_error != WSA_IO_PENDING) {
@@ -36,37 +47,24 @@ namespace spdnet {
             private:
                 void do_complete(size_t bytes_transferred, std::error_code ec) override {
                     bool force_close = false;
+                    io_impl_->metrics().on_recv(ec ? 0 : bytes_transferred);
                     if (bytes_transferred == 0 || ec) {
                         // eof 
                         force_close = true;
                     } else {
                         auto &recv_buffer = data_->recv_buffer_;
-                        auto post_len = recv_buffer.get_write_valid_count();
-                        recv_buffer.add_write_pos(bytes_transferred);
-                        if (nullptr != data_->data_callback_) {
-                            size_t len = data_->data_callback_(recv_buffer.get_data_ptr(), recv_buffer.get_length());
-                            assert(len <= recv_buffer.get_length());
-                            if (len <= recv_buffer.get_length()) {
-                                recv_buffer.remove_length(len);
-                            } else {
-                                force_close = true;
-                            }
-                        }
+                        recv_buffer.commit(bytes_transferred);
+                        if (!data_->deliver_recv_data(*io_impl_))
+                            force_close = true;
 
-                        if (post_len == bytes_transferred) {
-                            size_t grow_len = 0;
-                            if (recv_buffer.get_capacity() * 2 <= data_->max_recv_buffer_size_)
-                                grow_len = recv_buffer.get_capacity();
-                            else
-                                grow_len = data_->max_recv_buffer_size_ - recv_buffer.get_capacity();
-
-                            if (grow_len > 0)
-                                recv_buffer.grow(grow_len);
+                        // 读满说明还有大量数据 , 扩大下一次准备的空间 ; 否则回到一个块
+                        if (bytes_transferred == recv_len_) {
+                            if (recv_window_ < data_->max_recv_buffer_size_)
+                                recv_window_ *= 2;
+                        } else {
+                            recv_window_ = spdnet::base::chain_buffer::block_size;
                         }
-
-                        if (SPDNET_PREDICT_FALSE(
-                                recv_buffer.get_write_valid_count() == 0 || recv_buffer.get_length() == 0))
-                            recv_buffer.adjust_to_head();
+                        recv_buffer.shrink(*io_impl_);
                     }
 
 
@@ -77,7 +75,9 @@ namespace spdnet {
                 }
 
             private:
-                WSABUF buf_ = {0, 0};
+                WSABUF recv_buf_[max_recv_buf];
+                size_t recv_len_{0};
+                size_t recv_window_{spdnet::base::chain_buffer::block_size};
             };
         }
     }
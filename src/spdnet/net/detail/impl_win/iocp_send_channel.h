@@ -19,31 +19,25 @@ namespace spdnet {
                 }
 
                 void flush_buffer() {
-                    {
-                        std::lock_guard<spdnet::base::spin_lock> lck(data_->send_guard_);
-                        if (SPDNET_PREDICT_TRUE(data_->pending_packet_list_.empty())) {
-                            data_->pending_packet_list_.swap(data_->send_packet_list_);
-                        } else {
-                            for (const auto &packet : data_->send_packet_list_)
-                                data_->pending_packet_list_.push_back(packet);
-                            data_->send_packet_list_.clear();
-                        }
-                    }
+                    data_->merge_send_packets(*io_impl_);
 
                     constexpr size_t MAX_BUF_CNT = 1024;
                     WSABUF send_buf[MAX_BUF_CNT];
 
-                    size_t cnt = 0;
-                    size_t prepare_send_len = 0;
-                    for (const auto &packet : data_->pending_packet_list_) {
-                        send_buf[cnt].buf = packet.buffer_->get_data_ptr();
-                        send_buf[cnt].len = packet.buffer_->get_length();
-                        cnt++;
-                        if (cnt >= MAX_BUF_CNT)
-                            break;
+                    WSABUF *buf = send_buf;
+                    size_t cnt = data_->prepare_send_packets(MAX_BUF_CNT, [&buf](const char *data, size_t len) {
+                        buf->buf = const_cast<char *>(data);
+                        buf->len = static_cast<ULONG>(len);
+                        buf++;
+                    });
+                    if (cnt == 0) {
+                        // 生产者还没链接完节点 , 稍后重试
+                        if (data_->release_flush())
+                            io_impl_->post_flush(data_.get());
+                        return;
                     }
-                    assert(cnt > 0);
 
+                    data_->trace_send_attempt(*io_impl_, cnt);
                     DWORD send_len = 0;
                     const int result = ::WSASend(data_->sock_fd(),
                                                  send_buf,
@@ -60,36 +54,14 @@ namespace spdnet {
 
             private:
                 void do_complete(size_t bytes_transferred, std::error_code ec) override {
+                    io_impl_->metrics().send_calls.add();
                     if (bytes_transferred == 0 || ec) {
                         io_impl_->close_socket(data_);
                     } else {
-                        auto send_len = bytes_transferred;
-                        for (auto iter = data_->pending_packet_list_.begin();
-                             iter != data_->pending_packet_list_.end();) {
-                            auto &packet = *iter;
-                            if (SPDNET_PREDICT_TRUE(packet.buffer_->get_length() <= send_len)) {
-                                send_len -= packet.buffer_->get_length();
-                                packet.buffer_->clear();
-                                io_impl_->recycle_buffer(packet.buffer_);
-                                if (packet.callback_)
-                                    packet.callback_();
-                                iter = data_->pending_packet_list_.erase(iter);
-                            } else {
-                                packet.buffer_->remove_length(send_len);
-                                break;
-                            }
-
-                        }
-                        {
-                            std::unique_lock<spdnet::base::spin_lock> lck(data_->send_guard_);
-                            if (data_->send_packet_list_.empty() && data_->pending_packet_list_.empty()) {
-                                data_->is_post_flush_ = false;
-                            } else {
-                                lck.unlock();
-                                flush_buffer();
-                            }
-                        }
-
+                        data_->remove_sent_packets(*io_impl_, bytes_transferred);
+                        // WSASend在途期间flush状态一直保持 , 发完且没有新包时才释放
+                        if (!data_->pending_packet_list_.empty() || data_->release_flush())
+                            flush_buffer();
                     }
                 }
             };
@@ -0,0 +1,36 @@
+#ifndef SPDNET_NET_DISPATCH_POLICY_H_
+#define SPDNET_NET_DISPATCH_POLICY_H_
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <spdnet/base/platform.h>
+
+namespace spdnet {
+    namespace net {
+        class service_thread;
+
+        // event_service为新连接选择io线程的方式
+        enum class dispatch_policy {
+            // 随机选择
+            random,
+            // 依次轮流
+            round_robin,
+            // 当前会话数(含已分配但还未进入线程的)最少的线程
+            least_connections,
+            // 最近一段时间忙碌比例最低的线程 , 相同时选会话数少的
+            least_load,
+            // 按对端ip(不含端口)哈希 , 同一客户端的连接总在同一线程
+            peer_hash
+        };
+
+        /*
+         * 自定义的选择函数 , 返回threads中的下标 。peer是对端地址 , 不知道时为nullptr 。
+         * 可能在多个线程里同时调用 。
+        **/
+        using dispatch_function = std::function<size_t(const std::vector<std::shared_ptr<service_thread>> &threads,
+                                                       const struct sockaddr *peer)>;
+    }
+}
+
+#endif  // SPDNET_NET_DISPATCH_POLICY_H_
@@ -6,10 +6,15 @@
 #include <memory>
 #include <thread>
 #include <random>
+#include <atomic>
 #include <iostream>
 #include <spdnet/base/noncopyable.h>
 #include <spdnet/base/platform.h>
 #include <spdnet/net/service_thread.h>
+#include <spdnet/net/io_backend.h>
+#include <spdnet/net/end_point.h>
+#include <spdnet/net/dispatch_policy.h>
+#include <spdnet/net/thread_placement.h>
 #include <spdnet/net/env_init.h>
 
 namespace spdnet {
@@ -17,7 +22,7 @@ namespace spdnet {
         class event_service : public base::noncopyable {
         public:
 
-            event_service() noexcept;
+            explicit event_service(io_backend backend = default_io_backend) noexcept;
 
             ~event_service() noexcept;
 
@@ -25,17 +30,80 @@ namespace spdnet {
             add_tcp_session(sock_t fd, bool is_server_side, const tcp_enter_callback &enter_callback,
                             std::shared_ptr<service_thread> thread = nullptr);
 
+            // 之后run_thread启动的io线程使用大页内存池分配buffer , 见service_thread::use_hugepage_arena
+            void set_hugepage_arena(size_t max_bytes_per_thread, bool use_hugetlb = false) {
+                arena_max_bytes_ = max_bytes_per_thread;
+                arena_use_hugetlb_ = use_hugetlb;
+            }
+
+            // 之后run_thread启动的io线程使用忙轮询 , 见service_thread::set_busy_poll
+            void set_busy_poll(unsigned int spin_us, unsigned int socket_busy_poll_us = 0) {
+                busy_poll_us_ = spin_us;
+                socket_busy_poll_us_ = socket_busy_poll_us;
+            }
+
+            // 之后run_thread启动的io线程按placement绑定cpu和numa节点
+            void set_thread_placement(thread_placement placement) {
+                placement_ = std::move(placement);
+            }
+
+            // 新连接选择io线程的方式 , 默认随机 。需在开始建立连接之前设置
+            void set_dispatch_policy(dispatch_policy policy) {
+                dispatch_policy_ = policy;
+                dispatch_function_ = nullptr;
+            }
+
+            // 设置后代替dispatch_policy , 需在开始建立连接之前设置
+            void set_dispatch_function(dispatch_function func) {
+                dispatch_function_ = std::move(func);
+            }
+
             void run_thread(size_t thread_num);
 
+            // 按dispatch_policy选择io线程 , 可在多个线程里同时调用 ; 不知道对端地址时peer_hash退化为轮流分配
             std::shared_ptr<service_thread> get_service_thread();
 
+            std::shared_ptr<service_thread> get_service_thread(const end_point &peer);
+
+            /*
+             * 选择在cpu上运行的io线程 , 没有时选择同一numa节点上的线程 , 多个候选之间轮流分配 。
+             * 没有设置thread_placement或找不到合适的线程时返回nullptr 。
+            **/
+            std::shared_ptr<service_thread> get_service_thread_for_cpu(int cpu);
+
+            const std::vector<std::shared_ptr<service_thread>> &get_service_threads() const {
+                return threads_;
+            }
+
+            io_backend backend() const { return backend_; }
+
         private:
             void stop();
 
+            void build_cpu_threads();
+
+            std::shared_ptr<service_thread> select_thread(const struct sockaddr *peer);
+
+            size_t least_connections_index(size_t begin) const;
+
+            size_t least_load_index(size_t begin) const;
+
         private:
             std::shared_ptr<bool> run_thread_;
             std::vector<std::shared_ptr<service_thread>> threads_;
-            std::mt19937 random_;
+            io_backend backend_;
+            dispatch_policy dispatch_policy_{dispatch_policy::random};
+            dispatch_function dispatch_function_;
+            std::atomic<size_t> next_thread_index_{0};
+            // 0表示不使用大页内存池
+            size_t arena_max_bytes_{0};
+            bool arena_use_hugetlb_{false};
+            unsigned int busy_poll_us_{0};
+            unsigned int socket_busy_poll_us_{0};
+            thread_placement placement_;
+            // 下标是cpu , 值是优先处理该cpu上连接的线程下标
+            std::vector<std::vector<size_t>> cpu_threads_;
+            std::atomic<size_t> cpu_thread_index_{0};
             env_init env_;
         };
     }
@@ -3,6 +3,7 @@
 
 #include <spdnet/net/event_service.h>
 #include <iostream>
+#include <algorithm>
 #include <spdnet/net/socket_ops.h>
 #include <spdnet/net/exception.h>
 #include <spdnet/net/tcp_session.h>
@@ -11,8 +12,8 @@ namespace spdnet {
     namespace net {
         const static unsigned int default_loop_timeout = 100;
 
-        event_service::event_service() noexcept
-                : random_(time(0)) {
+        event_service::event_service(io_backend backend) noexcept
+                : backend_(backend) {
 
         }
 
@@ -21,14 +22,115 @@ namespace spdnet {
         }
 
         std::shared_ptr<service_thread> event_service::get_service_thread() {
-            auto rand_num = random_();
-            return threads_[rand_num % threads_.size()];
+            return select_thread(nullptr);
+        }
+
+        std::shared_ptr<service_thread> event_service::get_service_thread(const end_point &peer) {
+            return select_thread(peer.socket_addr());
+        }
+
+        namespace detail {
+            // 对端ip的FNV-1a哈希 , 不含端口
+            inline size_t hash_peer_address(const struct sockaddr *peer) {
+                const unsigned char *bytes = nullptr;
+                size_t len = 0;
+                if (peer->sa_family == AF_INET) {
+                    auto addr = reinterpret_cast<const struct sockaddr_in *>(peer);
+                    bytes = reinterpret_cast<const unsigned char *>(&addr->sin_addr);
+                    len = sizeof(addr->sin_addr);
+                } else if (peer->sa_family == AF_INET6) {
+                    auto addr = reinterpret_cast<const struct sockaddr_in6 *>(peer);
+                    bytes = reinterpret_cast<const unsigned char *>(&addr->sin6_addr);
+                    len = sizeof(addr->sin6_addr);
+                }
+                uint32_t hash = 2166136261u;
+                for (size_t i = 0; i < len; i++) {
+                    hash ^= bytes[i];
+                    hash *= 16777619u;
+                }
+                return hash;
+            }
+        }
+
+        std::shared_ptr<service_thread> event_service::select_thread(const struct sockaddr *peer) {
+            if (dispatch_function_ != nullptr)
+                return threads_[dispatch_function_(threads_, peer) % threads_.size()];
+
+            switch (dispatch_policy_) {
+                case dispatch_policy::round_robin:
+                    break;
+                case dispatch_policy::least_connections:
+                    return threads_[least_connections_index(
+                            next_thread_index_.fetch_add(1, std::memory_order_relaxed))];
+                case dispatch_policy::least_load:
+                    return threads_[least_load_index(next_thread_index_.fetch_add(1, std::memory_order_relaxed))];
+                case dispatch_policy::peer_hash:
+                    if (peer != nullptr)
+                        return threads_[detail::hash_peer_address(peer) % threads_.size()];
+                    break;
+                default: {
+                    // 每个调用线程各用一个随机数引擎 , 不需要加锁
+                    static thread_local std::mt19937 random(std::random_device{}());
+                    return threads_[random() % threads_.size()];
+                }
+            }
+            return threads_[next_thread_index_.fetch_add(1, std::memory_order_relaxed) % threads_.size()];
+        }
+
+        // 从begin开始找 , 数量相同的线程之间轮流分配
+        size_t event_service::least_connections_index(size_t begin) const {
+            size_t best = begin % threads_.size();
+            size_t best_count = threads_[best]->session_count();
+            for (size_t i = 1; i < threads_.size(); i++) {
+                size_t index = (begin + i) % threads_.size();
+                size_t count = threads_[index]->session_count();
+                if (count < best_count) {
+                    best = index;
+                    best_count = count;
+                }
+            }
+            return best;
+        }
+
+        // load要过一个统计周期才更新 , 同一周期内涌入的连接靠会话数分散开
+        size_t event_service::least_load_index(size_t begin) const {
+            size_t best = begin % threads_.size();
+            unsigned int best_load = threads_[best]->load();
+            size_t best_count = threads_[best]->session_count();
+            for (size_t i = 1; i < threads_.size(); i++) {
+                size_t index = (begin + i) % threads_.size();
+                unsigned int load = threads_[index]->load();
+                size_t count = threads_[index]->session_count();
+                if (load < best_load || (load == best_load && count < best_count)) {
+                    best = index;
+                    best_load = load;
+                    best_count = count;
+                }
+            }
+            return best;
+        }
+
+        std::shared_ptr<service_thread> event_service::get_service_thread_for_cpu(int cpu) {
+            if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_threads_.size())
+                return nullptr;
+            const auto &candidates = cpu_threads_[cpu];
+            if (candidates.empty())
+                return nullptr;
+            size_t index = cpu_thread_index_.fetch_add(1, std::memory_order_relaxed);
+            return threads_[candidates[index % candidates.size()]];
         }
 
         void event_service::add_tcp_session(sock_t fd, bool is_server_side, const tcp_enter_callback &enter_callback,
                                             std::shared_ptr<service_thread> thread) {
-            if (thread == nullptr)
-                thread = get_service_thread();
+            if (thread == nullptr) {
+                if (dispatch_function_ != nullptr || dispatch_policy_ == dispatch_policy::peer_hash) {
+                    auto peer = socket_ops::get_peer_addr(fd);
+                    thread = select_thread(reinterpret_cast<const struct sockaddr *>(&peer));
+                } else {
+                    thread = select_thread(nullptr);
+                }
+            }
+            thread->reserve_session();
             std::shared_ptr<tcp_session> new_session = tcp_session::create(fd, is_server_side, thread);
             thread->get_executor()->post([thread, new_session, enter_callback]() {
                 /*
@@ -47,10 +149,50 @@ namespace spdnet {
 
             run_thread_ = std::make_shared<bool>(true);
             for (size_t i = 0; i < thread_num; i++) {
-                auto thread = std::make_shared<service_thread>(default_loop_timeout);
+                auto thread = std::make_shared<service_thread>(default_loop_timeout, backend_);
+                if (!placement_.empty())
+                    thread->set_cpu_affinity(placement_.cpus_of(threads_.size()), placement_.bind_memory);
+                if (arena_max_bytes_ > 0)
+                    thread->use_hugepage_arena(arena_max_bytes_, arena_use_hugetlb_);
+                thread->set_busy_poll(busy_poll_us_, socket_busy_poll_us_);
                 thread->run(run_thread_);
                 threads_.push_back(thread);
             }
+            if (!placement_.empty())
+                build_cpu_threads();
+        }
+
+        void event_service::build_cpu_threads() {
+            std::vector<int> all_cpus;
+            for (int node : spdnet::base::numa::online_nodes()) {
+                for (int cpu : spdnet::base::numa::node_cpus(node))
+                    all_cpus.push_back(cpu);
+            }
+            int max_cpu = -1;
+            for (int cpu : all_cpus)
+                max_cpu = (std::max)(max_cpu, cpu);
+            for (const auto &thread : threads_) {
+                for (int cpu : thread->cpus())
+                    max_cpu = (std::max)(max_cpu, cpu);
+            }
+
+            cpu_threads_.assign(static_cast<size_t>(max_cpu + 1), std::vector<size_t>());
+            std::vector<int> thread_nodes;
+            for (size_t i = 0; i < threads_.size(); i++) {
+                thread_nodes.push_back(spdnet::base::numa::cpus_node(threads_[i]->cpus()));
+                for (int cpu : threads_[i]->cpus())
+                    cpu_threads_[cpu].push_back(i);
+            }
+            // 没有线程绑定在该cpu上时 , 退而选择同一节点上的线程
+            for (int cpu : all_cpus) {
+                if (!cpu_threads_[cpu].empty())
+                    continue;
+                int node = spdnet::base::numa::cpu_node(cpu);
+                for (size_t i = 0; i < threads_.size(); i++) {
+                    if (node >= 0 && thread_nodes[i] == node)
+                        cpu_threads_[cpu].push_back(i);
+                }
+            }
         }
 
         void event_service::stop() {
@@ -62,6 +204,7 @@ namespace spdnet {
                             thread->get_thread()->join();
                     }
 
+                    cpu_threads_.clear();
                     threads_.clear();
                 }
             }
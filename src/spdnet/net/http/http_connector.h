@@ -29,7 +29,7 @@ namespace spdnet {
                                                                                                         false);
 
                                                  new_tcp_session->set_data_callback(
-                                                         [new_http_session](const char *data, size_t len) -> size_t {
+                                                         [new_http_session](char *data, size_t len) -> size_t {
                                                              assert(new_http_session != nullptr);
                                                              return new_http_session->try_parse(data, len);
                                                          });
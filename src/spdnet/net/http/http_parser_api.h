@@ -316,6 +316,11 @@ namespace spdnet {
                 void set_version(const http_version &version) { version_ = version; }
 
                 std::string to_string() const {
+                    return header_to_string() + body_;
+                }
+
+                // 只序列化请求行和头部 , body可以作为单独的片段发送
+                std::string header_to_string() const {
                     std::ostringstream oss;
                     /*
                     if (url_.empty()) {
@@ -330,13 +335,12 @@ namespace spdnet {
                     oss << " HTTP/" << version_.to_string();
                     oss << "\r\n";
                     if (!body_.empty()) {
-                        const_cast<http_request &>(*this).add_header("Content-Length", std::to_string(body_.size()));
+                        const_cast<http_request &>(*this).headers_["Content-Length"] = std::to_string(body_.size());
                     }
                     for (const auto &pair : headers_) {
                         oss << pair.first << ": " << pair.second << "\r\n";
                     }
                     oss << "\r\n";
-                    oss << body_;
 
                     return oss.str();
                 }
@@ -440,17 +444,32 @@ namespace spdnet {
                 uint32_t get_status_code() const { return status_code_; }
 
                 std::string to_string() const {
-                    std::ostringstream oss;
+                    return header_to_string() + body_;
+                }
+
+                // 只序列化状态行和头部 , body可以作为单独的片段发送
+                std::string header_to_string() const {
                     if (!body_.empty()) {
-                        const_cast<http_response &>(*this).add_header("Content-Length", std::to_string(body_.size()));
+                        const_cast<http_response &>(*this).headers_["Content-Length"] = std::to_string(body_.size());
                     }
+                    return serialize_header();
+                }
+
+                // body由其它来源(如文件)提供时 , 按给定长度设置Content-Length
+                std::string header_to_string(size_t content_length) const {
+                    const_cast<http_response &>(*this).headers_["Content-Length"] = std::to_string(content_length);
+                    return serialize_header();
+                }
+
+            private:
+                std::string serialize_header() const {
+                    std::ostringstream oss;
                     oss << "HTTP/" << version_.to_string() << " " << status_code_ << " "
                         << status_text_ << "\r\n";
                     for (const auto &pair : headers_) {
                         oss << pair.first << ":" << pair.second << "\r\n";
                     }
                     oss << "\r\n";
-                    oss << body_;
 
                     return oss.str();
                 }
@@ -464,7 +483,7 @@ namespace spdnet {
 
             class http_parser_base {
             protected:
-                using websocket_data_handler = std::function<size_t(const char *, size_t)>;
+                using websocket_data_handler = std::function<size_t(char *, size_t)>;
 
                 http_parser_base(http_parser_type type, http_parser_settings &parser_settings)
                         : parser_settings_(parser_settings) {
@@ -473,7 +492,8 @@ namespace spdnet {
                 }
 
             public:
-                size_t try_parse(const char *data, size_t len) {
+                // 升级到websocket后data交给websocket_parser , 可能被原地去掩码
+                size_t try_parse(char *data, size_t len) {
                     if (parser_.upgrade) {
                         const size_t nparsed = websocket_data_handler_(data, len);
                         if (nparsed > len) {
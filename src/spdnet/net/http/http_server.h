@@ -24,7 +24,7 @@ namespace spdnet {
                     auto &&callback = std::move(enter_callback);
                     acceptor_.start(addr, [this, callback](std::shared_ptr<tcp_session> new_tcp_session) {
                         auto new_http_session = std::make_shared<http_session>(new_tcp_session, true);
-                        new_tcp_session->set_data_callback([new_http_session](const char *data, size_t len) -> size_t {
+                        new_tcp_session->set_data_callback([new_http_session](char *data, size_t len) -> size_t {
                             return new_http_session->try_parse(data, len);
                         });
                         new_tcp_session->set_disconnect_callback(
@@ -19,6 +19,8 @@ namespace spdnet {
                                                                   std::shared_ptr<http_session>)>;
                 using ws_frame_enter_callback = std::function<void(const websocket_frame &,
                                                                    std::shared_ptr<http_session>)>;
+                using ws_frame_view_callback = std::function<void(ws_opcode, spdnet::base::string_view,
+                                                                  std::shared_ptr<http_session>)>;
                 using ws_handshake_success_callback = std::function<void()>;
 
                 friend class http_server;
@@ -62,75 +64,97 @@ namespace spdnet {
                 void set_ws_frame_enter_callback(const ws_frame_enter_callback &callback) {
                     auto this_ptr = shared_from_this();
                     ws_parser_.set_ws_frame_complete_callback([callback, this_ptr](websocket_frame &frame) {
-                        if (frame.get_opcode() == ws_opcode::op_handshake_req) {
-                            std::string sec_key = frame.ws_key_;
-                            sec_key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
-
-                            CSHA1 s1;
-                            s1.Update((uint8_t *) sec_key.c_str(), static_cast<uint32_t>(sec_key.size()));
-                            s1.Final();
-                            uint8_t hash_buf[20] = {0};
-                            s1.GetHash(hash_buf);
-
-                            std::string base64_str = spdnet::base::util::base64_encode((const unsigned char *) hash_buf,
-                                                                                       sizeof(hash_buf));
-
-                            std::string handshake_ack = "HTTP/1.1 101 Switching Protocols\r\n"
-                                                        "Upgrade: websocket\r\n"
-                                                        "Connection: Upgrade\r\n"
-                                                        "Sec-WebSocket-Accept: ";
-
-                            handshake_ack += base64_str;
-                            handshake_ack += "\r\n\r\n";
-
-                            this_ptr->session_->send(handshake_ack.c_str(), handshake_ack.length(), [this_ptr]() {
-                                if (this_ptr->handshake_success_callback_ != nullptr)
-                                    this_ptr->handshake_success_callback_();
-                            });
-                            frame.reset();
-
-                        } else if (frame.get_opcode() == ws_opcode::op_handshake_ack) {
-                            if (this_ptr->handshake_success_callback_ != nullptr)
-                                this_ptr->handshake_success_callback_();
-                            frame.reset();
-                        } else {
+                        if (!this_ptr->handle_ws_handshake(frame)) {
                             // user callback
                             callback(frame, this_ptr);
                         }
                     });
                 }
 
+                /*
+                 * 以视图接收websocket消息 , 不拷贝负载 ; 视图指向接收缓冲区或分片拼接缓冲区 , 只在回调期间有效 。
+                 * 设置后取代set_ws_frame_enter_callback的数据帧回调 。
+                **/
+                void set_ws_frame_view_callback(const ws_frame_view_callback &callback) {
+                    auto this_ptr = shared_from_this();
+                    ws_parser_.set_ws_frame_complete_callback([this_ptr](websocket_frame &frame) {
+                        this_ptr->handle_ws_handshake(frame);
+                    });
+                    ws_parser_.set_ws_frame_view_callback(
+                            [callback, this_ptr](ws_opcode opcode, spdnet::base::string_view payload) {
+                                callback(opcode, payload, this_ptr);
+                            });
+                }
+
                 void send_response(const http_response &resp) {
                     assert(is_server_side_);
-                    auto stream = resp.to_string();
                     auto this_ptr = shared_from_this();
-                    if (session_)
-                        session_->send(stream.c_str(), stream.length(), [this_ptr]() {
+                    if (session_) {
+                        auto header = resp.header_to_string();
+                        const auto &body = resp.get_body();
+                        send_fragment fragments[2] = {{header.data(), header.length()},
+                                                      {body.data(), body.length()}};
+                        session_->send(fragments, 2, [this_ptr]() {
                             if (!this_ptr->request_parser_.get_request().is_keep_alive()) {
                                 this_ptr->shutdown();
                             }
                         });
-                    else {
+                    } else {
                         // throw error ?;
                     }
                 }
 
+#if defined(SPDNET_PLATFORM_LINUX)
+
+                // 响应body为文件区间[offset, offset + len) , 经sendfile发送 ; 发送完成后回调 , 之后才可以关闭file_fd
+                void send_file_response(const http_response &resp, int file_fd, off_t offset, size_t len,
+                                        socket_data::tcp_send_complete_callback &&callback = nullptr) {
+                    assert(is_server_side_);
+                    auto this_ptr = shared_from_this();
+                    if (session_) {
+                        session_->send(resp.header_to_string(len));
+                        auto cb = std::move(callback);
+                        session_->send_file(file_fd, offset, len, [this_ptr, cb]() {
+                            if (cb)
+                                cb();
+                            if (!this_ptr->request_parser_.get_request().is_keep_alive()) {
+                                this_ptr->shutdown();
+                            }
+                        });
+                    } else {
+                        // throw error ?;
+                    }
+                }
+
+#endif
+
                 void send_request(const http_request &req) {
                     assert(!is_server_side_);
-                    auto stream = req.to_string();
-                    if (session_)
-                        session_->send(stream.c_str(), stream.length());
-                    else {
+                    if (session_) {
+                        auto header = req.header_to_string();
+                        const auto &body = req.get_body();
+                        send_fragment fragments[2] = {{header.data(), header.length()},
+                                                      {body.data(), body.length()}};
+                        session_->send(fragments, 2);
+                    } else {
                         // throw error ?;
                     }
                 }
 
                 void send_ws_frame(const websocket_frame &frame) {
-                    auto stream = frame.to_string();
-                    if (session_)
-                        session_->send(stream.c_str(), stream.length());
-                    else {
+                    if (!session_) {
                         // throw ?
+                        return;
+                    }
+                    if (frame.mask_) {
+                        // 带掩码的负载需要变换 , 只能整体序列化
+                        session_->send(frame.to_string());
+                    } else {
+                        auto header = frame.header_to_string();
+                        const auto &payload = frame.get_payload();
+                        send_fragment fragments[2] = {{header.data(), header.length()},
+                                                      {payload.data(), payload.length()}};
+                        session_->send(fragments, 2);
                     }
                 }
 
@@ -159,13 +183,52 @@ namespace spdnet {
                 }
 
             private:
-                size_t try_parse(const char *data, size_t len) {
+                size_t try_parse(char *data, size_t len) {
                     if (is_server_side_)
                         return request_parser_.try_parse(data, len);
                     else
                         return response_parser_.try_parse(data, len);
                 }
 
+                // 处理握手帧 , 返回false表示是数据帧
+                bool handle_ws_handshake(websocket_frame &frame) {
+                    if (frame.get_opcode() == ws_opcode::op_handshake_req) {
+                        std::string sec_key = frame.ws_key_;
+                        sec_key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+                        CSHA1 s1;
+                        s1.Update((uint8_t *) sec_key.c_str(), static_cast<uint32_t>(sec_key.size()));
+                        s1.Final();
+                        uint8_t hash_buf[20] = {0};
+                        s1.GetHash(hash_buf);
+
+                        std::string base64_str = spdnet::base::util::base64_encode((const unsigned char *) hash_buf,
+                                                                                   sizeof(hash_buf));
+
+                        std::string handshake_ack = "HTTP/1.1 101 Switching Protocols\r\n"
+                                                    "Upgrade: websocket\r\n"
+                                                    "Connection: Upgrade\r\n"
+                                                    "Sec-WebSocket-Accept: ";
+
+                        handshake_ack += base64_str;
+                        handshake_ack += "\r\n\r\n";
+
+                        auto this_ptr = shared_from_this();
+                        session_->send(handshake_ack.c_str(), handshake_ack.length(), [this_ptr]() {
+                            if (this_ptr->handshake_success_callback_ != nullptr)
+                                this_ptr->handshake_success_callback_();
+                        });
+                        frame.reset();
+                        return true;
+                    } else if (frame.get_opcode() == ws_opcode::op_handshake_ack) {
+                        if (handshake_success_callback_ != nullptr)
+                            handshake_success_callback_();
+                        frame.reset();
+                        return true;
+                    }
+                    return false;
+                }
+
             private:
                 std::shared_ptr<tcp_session> session_;
                 bool is_server_side_{false};
@@ -0,0 +1,167 @@
+#ifndef SPDNET_NET_HTTP_WEBSOCKET_MASK_H_
+#define SPDNET_NET_HTTP_WEBSOCKET_MASK_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SPDNET_WS_MASK_X86 1
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace spdnet {
+    namespace net {
+        namespace http {
+            namespace detail {
+                /*
+                 * 以下函数把data[0, len)与重复的4字节掩码异或 , 掩码按内存顺序放在mask32里 , 从掩码第0个字节开始 。
+                 * 每次处理4的倍数字节后掩码相位不变 , 向量版本处理完整块后把剩余部分交给下一级 。
+                **/
+                inline void websocket_mask_scalar(uint8_t *data, size_t len, uint32_t mask32) {
+                    uint8_t mask_bytes[8];
+                    memcpy(mask_bytes, &mask32, 4);
+                    memcpy(mask_bytes + 4, &mask32, 4);
+                    uint64_t mask64;
+                    memcpy(&mask64, mask_bytes, 8);
+                    while (len >= 8) {
+                        uint64_t value;
+                        memcpy(&value, data, 8);
+                        value ^= mask64;
+                        memcpy(data, &value, 8);
+                        data += 8;
+                        len -= 8;
+                    }
+                    for (size_t i = 0; i < len; i++)
+                        data[i] ^= mask_bytes[i];
+                }
+
+#if defined(SPDNET_WS_MASK_X86)
+
+                // x86_64上SSE2总是可用
+                inline void websocket_mask_sse2(uint8_t *data, size_t len, uint32_t mask32) {
+                    const __m128i mask = _mm_set1_epi32(static_cast<int>(mask32));
+                    while (len >= 64) {
+                        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+                        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16));
+                        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32));
+                        __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(data), _mm_xor_si128(v0, mask));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + 16), _mm_xor_si128(v1, mask));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + 32), _mm_xor_si128(v2, mask));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + 48), _mm_xor_si128(v3, mask));
+                        data += 64;
+                        len -= 64;
+                    }
+                    while (len >= 16) {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(data), _mm_xor_si128(v, mask));
+                        data += 16;
+                        len -= 16;
+                    }
+                    websocket_mask_scalar(data, len, mask32);
+                }
+
+#if defined(__GNUC__) || defined(__clang__)
+                __attribute__((target("avx2")))
+#endif
+                inline void websocket_mask_avx2(uint8_t *data, size_t len, uint32_t mask32) {
+                    const __m256i mask = _mm256_set1_epi32(static_cast<int>(mask32));
+                    while (len >= 128) {
+                        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+                        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 32));
+                        __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 64));
+                        __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 96));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data), _mm256_xor_si256(v0, mask));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + 32), _mm256_xor_si256(v1, mask));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + 64), _mm256_xor_si256(v2, mask));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + 96), _mm256_xor_si256(v3, mask));
+                        data += 128;
+                        len -= 128;
+                    }
+                    while (len >= 32) {
+                        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data), _mm256_xor_si256(v, mask));
+                        data += 32;
+                        len -= 32;
+                    }
+                    websocket_mask_sse2(data, len, mask32);
+                }
+
+                inline bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+                    int info[4];
+                    __cpuid(info, 0);
+                    if (info[0] < 7)
+                        return false;
+                    __cpuid(info, 1);
+                    // 需要操作系统保存ymm寄存器
+                    bool osxsave = (info[2] & (1 << 27)) != 0;
+                    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+                        return false;
+                    __cpuidex(info, 7, 0);
+                    return (info[1] & (1 << 5)) != 0;
+#else
+                    __builtin_cpu_init();
+                    return __builtin_cpu_supports("avx2");
+#endif
+                }
+
+#endif
+
+                using websocket_mask_function = void (*)(uint8_t *, size_t, uint32_t);
+
+                // 第一次调用时按cpu支持的指令集选择实现
+                inline websocket_mask_function select_websocket_mask() {
+#if defined(SPDNET_WS_MASK_X86)
+                    if (cpu_has_avx2())
+                        return websocket_mask_avx2;
+                    return websocket_mask_sse2;
+#else
+                    return websocket_mask_scalar;
+#endif
+                }
+
+                inline websocket_mask_function websocket_mask_kernel() {
+                    static const websocket_mask_function kernel = select_websocket_mask();
+                    return kernel;
+                }
+
+                // 当前使用的实现 , 用于基准测试和日志
+                inline const char *websocket_mask_isa() {
+#if defined(SPDNET_WS_MASK_X86)
+                    if (websocket_mask_kernel() == websocket_mask_avx2)
+                        return "avx2";
+                    return "sse2";
+#else
+                    return "scalar";
+#endif
+                }
+            }
+
+            /*
+             * 对data[0, len)原地做websocket掩码变换 , 掩码和去掩码是同一操作 。
+             * offset是data[0]在掩码中的位置 , 负载分几次处理时传入已处理的字节数 。
+            **/
+            inline void websocket_mask(char *data, size_t len, const uint8_t mask[4], size_t offset = 0) {
+                uint8_t rotated[4];
+                for (size_t i = 0; i < 4; i++)
+                    rotated[i] = mask[(offset + i) & 3];
+                uint32_t mask32;
+                memcpy(&mask32, rotated, 4);
+                if (len < 16) {
+                    detail::websocket_mask_scalar(reinterpret_cast<uint8_t *>(data), len, mask32);
+                    return;
+                }
+                detail::websocket_mask_kernel()(reinterpret_cast<uint8_t *>(data), len, mask32);
+            }
+        }
+    }
+}
+
+#endif  // SPDNET_NET_HTTP_WEBSOCKET_MASK_H_
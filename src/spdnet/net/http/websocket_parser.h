@@ -2,12 +2,18 @@
 #define SPDNET_NET_HTTP_WEBSOCKET_PARSER_H_
 
 #include <memory>
+#include <random>
+#include <ctime>
+#include <cstring>
+#include <cassert>
 #include <sstream>
 #include <iostream>
 #include <functional>
 #include <spdnet/base/singleton.h>
 #include <spdnet/base/noncopyable.h>
 #include <spdnet/base/endian.h>
+#include <spdnet/base/string_view.h>
+#include <spdnet/net/http/websocket_mask.h>
 
 namespace spdnet {
     namespace net {
@@ -106,25 +112,47 @@ namespace spdnet {
                     mask_ = true;
                 }
 
+                // 帧头最长14字节
+                static constexpr size_t max_header_length = 14;
+
                 std::string to_string() const {
                     std::string result;
-                    static std::mt19937 random(time(0));
-                    result.clear();
-                    // max head length = 14
-                    result.resize(14 + payload_.length());
+                    result.resize(max_header_length + payload_.length());
                     uint8_t *buf = (uint8_t *) (const_cast<char *>(result.data()));
-                    uint32_t pos = 0;
+                    size_t pos = encode_header(buf);
+
+                    memcpy(buf + pos, payload_.data(), payload_.length());
+                    if (mask_)
+                        websocket_mask(reinterpret_cast<char *>(buf + pos), payload_.length(), buf + pos - 4);
+                    result.resize(pos + payload_.length());
+                    return result;
+                }
+
+                // 只序列化帧头 ; 不带掩码时负载无需变换 , 可以作为单独的片段直接发送
+                std::string header_to_string() const {
+                    uint8_t buf[max_header_length];
+                    size_t pos = encode_header(buf);
+                    return std::string((const char *) buf, pos);
+                }
+
+            private:
+                // 写入帧头 , 带掩码时包含随机生成的4字节掩码 , 返回帧头长度
+                size_t encode_header(uint8_t *buf) const {
+                    static std::mt19937 random(time(0));
+                    size_t pos = 0;
                     buf[pos++] = static_cast<uint8_t>(opcode_) | (fin_ ? 0x80 : 0x00);
 
                     if (payload_.length() <= 125) {
                         buf[pos++] = static_cast<uint8_t>(payload_.length());
                     } else if (payload_.length() <= 0xFFFF) {
                         buf[pos++] = 126;
-                        *(uint16_t *) (&buf[pos]) = spdnet::base::util::host_to_net_16(payload_.length());
+                        uint16_t net_len = spdnet::base::util::host_to_net_16(static_cast<uint16_t>(payload_.length()));
+                        memcpy(buf + pos, &net_len, 2);
                         pos += 2;
                     } else {
                         buf[pos++] = 127;
-                        *(uint64_t *) (&buf[pos]) = spdnet::base::util::host_to_net_64(payload_.length());
+                        uint64_t net_len = spdnet::base::util::host_to_net_64(payload_.length());
+                        memcpy(buf + pos, &net_len, 8);
                         pos += 8;
                     }
 
@@ -132,15 +160,9 @@ namespace spdnet {
                         buf[1] |= 0x80;
                         for (size_t i = 0; i < 4; i++)
                             buf[pos + i] = static_cast<uint8_t>(random());
-                        for (size_t i = 0; i < payload_.length(); i++)
-                            buf[pos + 4 + i] = static_cast<uint8_t>(payload_[i]) ^ buf[pos + i % 4];
-
-                        pos += (4 + payload_.length());
-                    } else {
-                        memcpy(buf + pos, payload_.c_str(), payload_.length());
+                        pos += 4;
                     }
-                    result.resize(pos + payload_.length());
-                    return result;
+                    return pos;
                 }
 
             private:
@@ -155,8 +177,13 @@ namespace spdnet {
             class websocket_parser {
             public:
                 using ws_frame_complete_callback = std::function<void(websocket_frame &)>;
+                using ws_frame_view_callback = std::function<void(ws_opcode, spdnet::base::string_view)>;
 
-                size_t try_ws_parse(const char *data, size_t len) {
+                /*
+                 * 设置了view回调时 , 完整的单帧消息和控制帧在data里原地去掩码 , 回调拿到指向data的视图 , 没有拷贝 ;
+                 * 分片消息仍拼接到内部缓冲区 , 最后一片到达时以指向该缓冲区的视图回调 。视图只在回调期间有效 。
+                **/
+                size_t try_ws_parse(char *data, size_t len) {
                     if (!sec_websocket_key_.empty()) {
                         // handshake frame
                         frame_.opcode_ = ws_opcode::op_handshake_req;
@@ -174,24 +201,36 @@ namespace spdnet {
                     }
                     size_t left_len = len;
                     while (left_len > 0) {
-                        bool fin_flag;
-                        std::string payload;
-                        ws_opcode opcode;
-                        size_t frame_size = 0;
-                        if (!try_parse_frame(data, left_len, fin_flag, payload, opcode, frame_size))
+                        frame_header header;
+                        if (!try_parse_frame_header(data, left_len, header))
                             break;
-                        assert(frame_size > 0);
-                        frame_.payload_ += payload;
-                        if (opcode != ws_opcode::op_continuation_frame)
-                            frame_.opcode_ = opcode;
-                        assert(left_len >= frame_size);
+                        size_t frame_size = header.header_len + header.payload_len;
+                        assert(frame_size > 0 && left_len >= frame_size);
+                        char *payload = data + header.header_len;
                         data += frame_size;
                         left_len -= frame_size;
 
-                        if (!fin_flag)
+                        if (view_callback_ != nullptr && header.fin && can_deliver_directly(header.opcode)) {
+                            if (header.masked)
+                                websocket_mask(payload, header.payload_len, header.mask_key);
+                            view_callback_(header.opcode, spdnet::base::string_view(payload, header.payload_len));
                             continue;
+                        }
 
-                        if (callback_ != nullptr)
+                        // 负载拼接到frame_ , 先整体拷贝 , 再原地去掩码
+                        size_t old_len = frame_.payload_.length();
+                        frame_.payload_.append(payload, header.payload_len);
+                        if (header.masked)
+                            websocket_mask(&frame_.payload_[old_len], header.payload_len, header.mask_key);
+                        if (header.opcode != ws_opcode::op_continuation_frame)
+                            frame_.opcode_ = header.opcode;
+
+                        if (!header.fin)
+                            continue;
+
+                        if (view_callback_ != nullptr)
+                            view_callback_(frame_.opcode_, spdnet::base::string_view(frame_.payload_));
+                        else if (callback_ != nullptr)
                             callback_(frame_);
 
                         frame_.reset();
@@ -200,10 +239,15 @@ namespace spdnet {
                     return len - left_len;
                 }
 
+                // 握手帧总是通过这个回调 ; 没有设置view回调时 , 数据帧也通过它 , 负载拷贝在frame里
                 void set_ws_frame_complete_callback(ws_frame_complete_callback &&callback) {
                     callback_ = std::move(callback);
                 }
 
+                void set_ws_frame_view_callback(ws_frame_view_callback &&callback) {
+                    view_callback_ = std::move(callback);
+                }
+
                 void set_sec_websocket_key(const std::string &str) {
                     sec_websocket_key_ = str;
                 }
@@ -213,17 +257,32 @@ namespace spdnet {
                 }
 
             private:
-                bool
-                try_parse_frame(const char *data, size_t len, bool &fin_flag, std::string &payload, ws_opcode &opcode,
-                                size_t &frame_size) {
-                    int pos = 0;
+                struct frame_header {
+                    bool fin{true};
+                    ws_opcode opcode{ws_opcode::op_unknow};
+                    bool masked{false};
+                    uint8_t mask_key[4];
+                    size_t header_len{0};
+                    size_t payload_len{0};
+                };
+
+                // 控制帧可以插在分片消息中间 , 不影响正在拼接的消息 ; 数据帧只有在没有未完成的消息时才能直接交付
+                bool can_deliver_directly(ws_opcode opcode) const {
+                    if (static_cast<int>(opcode) >= static_cast<int>(ws_opcode::op_close_frame))
+                        return true;
+                    return opcode != ws_opcode::op_continuation_frame && frame_.opcode_ == ws_opcode::op_unknow;
+                }
+
+                // 整个帧(包括负载)都已到达时返回true
+                static bool try_parse_frame_header(const char *data, size_t len, frame_header &header) {
+                    size_t pos = 0;
                     auto buf = (const uint8_t *) data;
                     if (len < 2)
                         return false;
 
-                    fin_flag = buf[pos] & 0x80 ? true : false;
-                    opcode = static_cast<ws_opcode>(buf[pos++] & 0x0F);
-                    bool mask_flag = buf[pos] & 0x80 ? true : false;
+                    header.fin = buf[pos] & 0x80 ? true : false;
+                    header.opcode = static_cast<ws_opcode>(buf[pos++] & 0x0F);
+                    header.masked = buf[pos] & 0x80 ? true : false;
                     uint64_t payload_len = buf[pos++] & 0x7F;
                     if (payload_len == 126) {
                         if (len < 4)
@@ -234,32 +293,24 @@ namespace spdnet {
                         pos += 2;
                     } else if (payload_len == 127) {
                         if (len < 10)
-                            return len;
+                            return false;
                         uint64_t tmp_len = 0;
                         memcpy(&tmp_len, buf + pos, 8);
                         payload_len = spdnet::base::util::net_to_host_64(tmp_len);
                         pos += 8;
                     }
-                    uint8_t mask_buf[4];
-                    if (mask_flag) {
+                    if (header.masked) {
                         if (len < pos + 4) {
                             return false;
                         }
-                        std::copy(buf + pos, buf + pos + 4, mask_buf);
+                        memcpy(header.mask_key, buf + pos, 4);
                         pos += 4;
                     }
-                    if (len < pos + payload_len)
+                    if (payload_len > len - pos)
                         return false;
 
-                    if (mask_flag) {
-                        payload.reserve(payload_len);
-                        for (size_t i = 0; i < payload_len; i++)
-                            payload.push_back(buf[pos + i] ^ mask_buf[i % 4]);
-                    } else {
-                        payload.append((const char *) (buf + pos), payload_len);
-                    }
-
-                    frame_size = payload_len + pos;
+                    header.header_len = pos;
+                    header.payload_len = static_cast<size_t>(payload_len);
                     return true;
                 }
 
@@ -268,6 +319,7 @@ namespace spdnet {
                 std::string sec_websocket_accept_;
                 websocket_frame frame_;
                 ws_frame_complete_callback callback_;
+                ws_frame_view_callback view_callback_;
             };
 
         }
@@ -0,0 +1,22 @@
+#ifndef SPDNET_NET_IO_BACKEND_H_
+#define SPDNET_NET_IO_BACKEND_H_
+
+#include <spdnet/base/platform.h>
+
+namespace spdnet {
+    namespace net {
+        enum class io_backend {
+            epoll,
+            io_uring,
+            iocp
+        };
+
+#if defined(SPDNET_PLATFORM_WINDOWS)
+        constexpr io_backend default_io_backend = io_backend::iocp;
+#else
+        constexpr io_backend default_io_backend = io_backend::epoll;
+#endif
+    }
+}
+
+#endif  // SPDNET_NET_IO_BACKEND_H_
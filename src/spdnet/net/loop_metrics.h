@@ -0,0 +1,159 @@
+#ifndef SPDNET_NET_LOOP_METRICS_H_
+#define SPDNET_NET_LOOP_METRICS_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/stat_counter.h>
+#include <spdnet/base/buffer_pool.h>
+#include <spdnet/base/latency_histogram.h>
+
+namespace spdnet {
+    namespace net {
+        // 循环耗时直方图的桶数 , 第0个桶是1us以内 , 第i个桶是[2^(i-1), 2^i)us , 最后一个桶包含更长的
+        constexpr size_t loop_latency_buckets = 24;
+
+        // 某一时刻的统计值 , 计数都是线程启动以来的累计值 , 两次快照相减得到区间内的量
+        struct loop_metrics_snapshot {
+            // io等待次数和返回的事件总数
+            uint64_t waits{0};
+            uint64_t events{0};
+            // 一次io等待最多取回的事件数 , 取满时加倍 ; 不适用的后端为0
+            uint64_t event_capacity{0};
+            uint64_t event_capacity_grows{0};
+            // 有事件或task的循环次数 , 以及其中执行的task总数
+            uint64_t busy_loops{0};
+            uint64_t tasks{0};
+            // 从io等待返回到本轮循环结束的耗时 , 只统计有事件或task的循环
+            std::array<uint64_t, loop_latency_buckets> loop_latency_us{};
+            uint64_t bytes_in{0};
+            uint64_t bytes_out{0};
+            // readv/recvmsg和writev/sendmsg/sendfile的次数 , 以及其中返回EAGAIN的次数
+            uint64_t recv_calls{0};
+            uint64_t send_calls{0};
+            uint64_t eagain{0};
+            // 本线程从buffer_pool分配时命中缓存(含从全局仓库补充)和需要向系统申请的次数
+            uint64_t buffer_hits{0};
+            uint64_t buffer_misses{0};
+            // 当前的会话数 , 以及已由本线程接手、还没写入socket的字节数
+            uint64_t sessions{0};
+            uint64_t pending_send_bytes{0};
+
+            double events_per_wait() const {
+                return waits > 0 ? static_cast<double>(events) / waits : 0.0;
+            }
+
+            double tasks_per_loop() const {
+                return busy_loops > 0 ? static_cast<double>(tasks) / busy_loops : 0.0;
+            }
+
+            // 循环耗时的分位数 , 返回所在桶的上界(us)
+            uint64_t loop_latency_percentile(double percentile) const {
+                uint64_t total = 0;
+                for (auto count : loop_latency_us)
+                    total += count;
+                if (total == 0)
+                    return 0;
+                uint64_t rank = static_cast<uint64_t>(total * percentile / 100);
+                uint64_t seen = 0;
+                for (size_t i = 0; i < loop_latency_buckets; i++) {
+                    seen += loop_latency_us[i];
+                    if (seen > rank)
+                        return uint64_t(1) << i;
+                }
+                return uint64_t(1) << (loop_latency_buckets - 1);
+            }
+        };
+
+        // 开启了耗时跟踪的会话在本线程汇总的耗时分布
+        struct session_latency_snapshot {
+            // readv(或接收完成)返回到data_callback返回
+            spdnet::base::latency_histogram_snapshot recv_to_callback;
+            // tcp_session::send入队到第一次尝试写入socket , 包括跨线程投递和排在其它会话、其它包后面的时间
+            spdnet::base::latency_histogram_snapshot send_to_write;
+            // tcp_session::send入队到发送完成回调 , 再减去send_to_write大致就是等待内核socket缓冲区的时间
+            spdnet::base::latency_histogram_snapshot send_to_complete;
+        };
+
+        struct session_latency : public spdnet::base::noncopyable {
+            session_latency_snapshot snapshot() const {
+                session_latency_snapshot result;
+                result.recv_to_callback = recv_to_callback.snapshot();
+                result.send_to_write = send_to_write.snapshot();
+                result.send_to_complete = send_to_complete.snapshot();
+                return result;
+            }
+
+            spdnet::base::latency_histogram recv_to_callback;
+            spdnet::base::latency_histogram send_to_write;
+            spdnet::base::latency_histogram send_to_complete;
+        };
+
+        /*
+         * 一个io线程的运行统计 , 由io线程更新 , 可在任意线程调用snapshot 。
+         * 每项都是单写者的stat_counter , 更新时没有锁和原子读改写 。
+        **/
+        struct loop_metrics : public spdnet::base::noncopyable {
+            void on_wait(size_t num_events) {
+                waits.add();
+                events.add(num_events);
+            }
+
+            void on_loop(size_t num_tasks, uint64_t latency_us) {
+                busy_loops.add();
+                tasks.add(num_tasks);
+                size_t bucket = 0;
+                while (latency_us > 0 && bucket + 1 < loop_latency_buckets) {
+                    latency_us >>= 1;
+                    bucket++;
+                }
+                loop_latency_us[bucket].add();
+            }
+
+            void on_recv(size_t len) {
+                recv_calls.add();
+                bytes_in.add(len);
+            }
+
+            loop_metrics_snapshot snapshot() const {
+                loop_metrics_snapshot result;
+                result.waits = waits.get();
+                result.events = events.get();
+                result.event_capacity = event_capacity.get();
+                result.event_capacity_grows = event_capacity_grows.get();
+                result.busy_loops = busy_loops.get();
+                result.tasks = tasks.get();
+                for (size_t i = 0; i < loop_latency_buckets; i++)
+                    result.loop_latency_us[i] = loop_latency_us[i].get();
+                result.bytes_in = bytes_in.get();
+                result.bytes_out = bytes_out.get();
+                result.recv_calls = recv_calls.get();
+                result.send_calls = send_calls.get();
+                result.eagain = eagain.get();
+                result.buffer_hits = buffer_stats.hits_.get();
+                result.buffer_misses = buffer_stats.misses_.get();
+                result.pending_send_bytes = pending_send_bytes.get();
+                return result;
+            }
+
+            spdnet::base::stat_counter waits;
+            spdnet::base::stat_counter events;
+            spdnet::base::stat_counter event_capacity;
+            spdnet::base::stat_counter event_capacity_grows;
+            spdnet::base::stat_counter busy_loops;
+            spdnet::base::stat_counter tasks;
+            std::array<spdnet::base::stat_counter, loop_latency_buckets> loop_latency_us;
+            spdnet::base::stat_counter bytes_in;
+            spdnet::base::stat_counter bytes_out;
+            spdnet::base::stat_counter recv_calls;
+            spdnet::base::stat_counter send_calls;
+            spdnet::base::stat_counter eagain;
+            spdnet::base::stat_counter pending_send_bytes;
+            spdnet::base::buffer_pool::alloc_stats buffer_stats;
+            session_latency latency;
+        };
+    }
+}
+
+#endif  // SPDNET_NET_LOOP_METRICS_H_
@@ -2,6 +2,7 @@
 #define SPDNET_NET_SERVICE_THREAD_H_
 
 #include <thread>
+#include <chrono>
 #include <mutex>
 #include <vector>
 #include <atomic>
@@ -10,12 +11,16 @@
 #include <spdnet/base/platform.h>
 #include <spdnet/net/current_thread.h>
 #include <spdnet/base/buffer_pool.h>
+#include <spdnet/base/numa.h>
 #include <spdnet/net/task_executor.h>
 #include <spdnet/net/channel_collector.h>
+#include <spdnet/net/timer_wheel.h>
+#include <spdnet/net/io_backend.h>
 
 #ifdef SPDNET_PLATFORM_LINUX
 
 #include <spdnet/net/detail/impl_linux/epoll_impl.h>
+#include <spdnet/net/detail/impl_linux/io_uring_impl.h>
 
 #else
 #include <spdnet/net/detail/impl_win/iocp_impl.h>
@@ -29,12 +34,90 @@ namespace spdnet {
 
         class service_thread : public spdnet::net::wakeup_base, spdnet::base::noncopyable {
         public:
-            explicit service_thread(unsigned int);
+            // 每隔这么久把本线程和全局仓库里空闲的buffer还给系统
+            static constexpr unsigned int buffer_trim_interval_ms = 1000;
+
+            // 每隔这么久统计一次忙碌比例 , 和之前的值平均后作为load
+            static constexpr unsigned int load_sample_interval_ms = 100;
+
+            // 指定的后端在当前系统上不可用时回退到平台默认后端
+            explicit service_thread(unsigned int, io_backend backend = default_io_backend);
 
             ~service_thread() = default;
 
             void run(std::shared_ptr<bool>);
 
+            /*
+             * 本线程分配的buffer改从大页内存池分配 , 每个线程最多映射max_bytes , 用完后回退到buffer_pool ; 其它线程发起send时仍用buffer_pool 。
+             * use_hugetlb为true时先尝试hugetlbfs预留的大页 。只在linux上生效 , 需在run之前调用 。
+            **/
+            void use_hugepage_arena(size_t max_bytes, bool use_hugetlb);
+
+            /*
+             * 线程启动时绑定到cpus 。bind_memory为true且cpus都在同一个numa节点上时 ,
+             * 线程的内存优先从该节点分配 , 大页内存池也映射在该节点上 。需在use_hugepage_arena和run之前调用 。
+            **/
+            void set_cpu_affinity(std::vector<int> cpus, bool bind_memory);
+
+            /*
+             * 自适应忙轮询 。处理完事件后继续以0超时轮询spin_us以内再阻塞 , 轮询期间其它线程投递task不再写eventfd 。
+             * 实际轮询时长在spin_us以内自动调整 : 阻塞后不久就来了事件时加倍 , 阻塞超过spin_us才来事件时减半 ,
+             * 空闲的线程很快回到阻塞等待 。socket_busy_poll_us大于0时对本线程的连接设置SO_BUSY_POLL 。
+             * 只在linux上轮询socket , 需在run之前调用 , spin_us为0表示关闭 。
+            **/
+            void set_busy_poll(unsigned int spin_us, unsigned int socket_busy_poll_us = 0) {
+                busy_poll_us_ = spin_us;
+                socket_busy_poll_us_ = socket_busy_poll_us;
+            }
+
+            const std::vector<int> &cpus() const {
+                return cpus_;
+            }
+
+            // 会话数 , 包括已分配到本线程但还没进入io循环的 , 可在任意线程读取
+            size_t session_count() const {
+                return session_count_.load(std::memory_order_relaxed);
+            }
+
+            // 分配新连接时计数 , 会话进入失败或移除时减去
+            void reserve_session() {
+                session_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // 最近的忙碌比例 , 单位千分之一 , 可在任意线程读取
+            unsigned int load() const {
+                return load_.load(std::memory_order_relaxed);
+            }
+
+            // 本线程的运行统计快照 , 可在任意线程调用
+            loop_metrics_snapshot metrics() const {
+                loop_metrics_snapshot snapshot = io_impl_->metrics().snapshot();
+                snapshot.sessions = session_count();
+                return snapshot;
+            }
+
+            // 本线程上开启了耗时跟踪的会话的耗时分布 , 可在任意线程调用
+            session_latency_snapshot latency_metrics() const {
+                return io_impl_->metrics().latency.snapshot();
+            }
+
+            // 内存绑定的numa节点 , 没有绑定时为-1
+            int numa_node() const {
+                return numa_node_;
+            }
+
+            /*
+             * 本线程的定时器 , 精度1ms , 回调在本线程执行 。可在任意线程调用 , 其它线程调用时投递到本线程再添加 。
+             * 返回的id用于cancel_timer , 不会为0 。
+            **/
+            timer_id run_after(unsigned int delay_ms, timer_callback callback);
+
+            // 每隔interval_ms执行一次 , 直到cancel_timer
+            timer_id run_every(unsigned int interval_ms, timer_callback callback);
+
+            // 已经执行过的一次性定时器和不存在的id被忽略 , 可以在定时器回调里调用
+            void cancel_timer(timer_id id);
+
             void on_tcp_session_enter(sock_t fd, std::shared_ptr<tcp_session> tcp_session,
                                       const tcp_enter_callback &enter_callback);
 
@@ -44,6 +127,24 @@ namespace spdnet {
 
             void add_tcp_session(sock_t fd, std::shared_ptr<tcp_session>);
 
+            /*
+             * 把本线程的会话迁移到target , 只能在本线程调用 , 一般通过tcp_session::migrate 。
+             * 在本线程解除socket关联后交给target重新关联 , 两个线程都不支持迁移时什么也不做 。
+            **/
+            void migrate_tcp_session(const std::shared_ptr<tcp_session> &session, std::shared_ptr<service_thread> target);
+
+            // 遍历本线程的会话 , 只能在本线程调用
+            template<typename Func>
+            void for_each_tcp_session(Func &&func) {
+                for (auto &item : tcp_sessions_)
+                    func(item.second);
+            }
+
+            // 从run到io循环退出之间为true , 可在任意线程读取 ; 为false时投递的task不会再执行
+            bool is_running() const {
+                return running_.load(std::memory_order_acquire);
+            }
+
             const std::shared_ptr<std::thread> &get_thread() const {
                 return thread_;
             }
@@ -63,13 +164,24 @@ namespace spdnet {
 
             thread_id_t thread_id() const { return thread_id_; }
 
+            io_backend backend() const {
+                return io_impl_->backend();
+            }
+
             std::shared_ptr<channel_collector> get_channel_collector() {
                 return channel_collector_;
             }
 
         private:
+            // 一轮循环内只需唤醒一次 , 标记在io等待返回后、执行task前清除
             void wakeup() override {
-                if (!wakeup_flag_.exchange(true))
+                if (busy_poll_us_ > 0) {
+                    // 与run里停止轮询后的检查配对 : 要么这里看到正在轮询 , 要么io线程阻塞前看到新task
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (spinning_.load(std::memory_order_relaxed))
+                        return;
+                }
+                if (wakeup_flag_.exchange(true))
                     return;
                 io_impl_->wakeup();
             }
@@ -78,15 +190,33 @@ namespace spdnet {
                 wakeup_flag_ = false;
             }
 
+            void on_tcp_session_migrated(const std::shared_ptr<tcp_session> &session, bool owns_flush);
+
+            timer_id add_timer(unsigned int delay_ms, unsigned int interval_ms, timer_callback &&callback);
+
+            static int64_t to_tick(std::chrono::steady_clock::time_point time) {
+                return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+            }
+
         private:
             thread_id_t thread_id_;
             std::shared_ptr<detail::io_object_impl_type> io_impl_;
             std::shared_ptr<task_executor> task_executor_;
             std::atomic_bool wakeup_flag_{false};
+            std::atomic_bool running_{false};
+            unsigned int busy_poll_us_{0};
+            unsigned int socket_busy_poll_us_{0};
+            std::atomic_bool spinning_{false};
             std::shared_ptr<channel_collector> channel_collector_;
             std::shared_ptr<std::thread> thread_;
             unsigned int wait_timeout_ms_;
+            std::vector<int> cpus_;
+            int numa_node_{-1};
             std::unordered_map<sock_t, std::shared_ptr<tcp_session>> tcp_sessions_;
+            std::atomic<size_t> session_count_{0};
+            std::atomic<unsigned int> load_{0};
+            timer_wheel timer_wheel_;
+            std::atomic<timer_id> next_timer_id_{1};
         };
     }
 }
@@ -4,6 +4,7 @@
 #include <memory>
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 #include <spdnet/net/service_thread.h>
 #include <spdnet/net/current_thread.h>
 #include <spdnet/net/exception.h>
@@ -12,15 +13,40 @@
 namespace spdnet {
     namespace net {
 
-        service_thread::service_thread(unsigned int wait_timeout_ms)
-                : wait_timeout_ms_(wait_timeout_ms) {
+        service_thread::service_thread(unsigned int wait_timeout_ms, io_backend backend)
+                : wait_timeout_ms_(wait_timeout_ms), timer_wheel_(to_tick(std::chrono::steady_clock::now())) {
             task_executor_ = std::make_shared<task_executor>(this);
             channel_collector_ = std::make_shared<channel_collector>();
-            auto impl = std::make_shared<detail::io_object_impl_type>(task_executor_, channel_collector_,
-                                                                      [this](sock_t fd) {
-                                                                          remove_tcp_session(fd);
-                                                                      });
-            io_impl_ = impl;
+            auto close_notify = [this](sock_t fd) {
+                remove_tcp_session(fd);
+            };
+#if defined(SPDNET_PLATFORM_LINUX)
+#if defined(SPDNET_HAS_IO_URING)
+            if (backend == io_backend::io_uring && detail::io_uring_impl::is_supported()) {
+                io_impl_ = std::make_shared<detail::io_uring_impl>(task_executor_, channel_collector_, close_notify);
+            }
+#endif
+            if (io_impl_ == nullptr) {
+                io_impl_ = std::make_shared<detail::epoll_impl>(task_executor_, channel_collector_, close_notify);
+            }
+#else
+            (void) backend;
+            io_impl_ = std::make_shared<detail::io_object_impl_type>(task_executor_, channel_collector_, close_notify);
+#endif
+        }
+
+        void service_thread::use_hugepage_arena(size_t max_bytes, bool use_hugetlb) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            io_impl_->set_buffer_arena(spdnet::base::hugepage_arena::create(max_bytes, use_hugetlb, numa_node_));
+#else
+            (void) max_bytes;
+            (void) use_hugetlb;
+#endif
+        }
+
+        void service_thread::set_cpu_affinity(std::vector<int> cpus, bool bind_memory) {
+            cpus_ = std::move(cpus);
+            numa_node_ = bind_memory ? spdnet::base::numa::cpus_node(cpus_) : -1;
         }
 
         std::shared_ptr<tcp_session> service_thread::get_tcp_session(sock_t fd) {
@@ -38,7 +64,9 @@ namespace spdnet {
         void service_thread::remove_tcp_session(sock_t fd) {
             auto iter = tcp_sessions_.find(fd);
             if (iter != tcp_sessions_.end()) {
+                iter->second->cancel_timeout_timer();
                 tcp_sessions_.erase(iter);
+                session_count_.fetch_sub(1, std::memory_order_relaxed);
             } else {
                 assert(false);
             }
@@ -47,7 +75,12 @@ namespace spdnet {
         void
         service_thread::on_tcp_session_enter(sock_t fd, std::shared_ptr<tcp_session> tcp_session,
                                              const tcp_enter_callback &enter_callback) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            if (socket_busy_poll_us_ > 0)
+                socket_ops::socket_busy_poll(fd, socket_busy_poll_us_);
+#endif
             if (!io_impl_->on_socket_enter(tcp_session->socket_data_)) {
+                session_count_.fetch_sub(1, std::memory_order_relaxed);
                 return;
             }
             if (nullptr != enter_callback)
@@ -56,21 +89,196 @@ namespace spdnet {
             add_tcp_session(fd, std::move(tcp_session));
         }
 
+        void service_thread::migrate_tcp_session(const std::shared_ptr<tcp_session> &session,
+                                                 std::shared_ptr<service_thread> target) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            auto data = session->socket_data_;
+            if (target == nullptr || target.get() == this || session->current_thread() != this || data->has_closed_)
+                return;
+            if (!io_impl_->support_migration() || !target->io_impl_->support_migration())
+                return;
+            if (!io_impl_->detach_socket(data))
+                return;
+            // 超时定时器挂在本线程的时间轮上 , 到新线程后重新挂
+            session->cancel_timeout_timer();
+
+            /*
+             * 抢到flush的发送权后其它线程不会再投递flush , 由新线程关联后发送 。
+             * 已有flush在途时 , 它可能按旧的线程指针投递到本线程再转投 , 先保持socket_data存活 。
+            **/
+            bool owns_flush = !data->is_flush_scheduled_.exchange(true, std::memory_order_acq_rel);
+            if (!owns_flush)
+                data->migration_pin_ = data;
+
+            auto iter = tcp_sessions_.find(data->sock_fd());
+            if (iter != tcp_sessions_.end()) {
+                tcp_sessions_.erase(iter);
+                session_count_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            target->reserve_session();
+            session->thread_holders_.push_back(target);
+            data->owner_impl_.store(static_cast<const detail::io_impl *>(target->io_impl_.get()),
+                                    std::memory_order_release);
+            // 此后读到新线程的发送方都不会再投递到本线程 ; 新线程关联之前执行的flush什么也不做
+            session->service_thread_.store(target.get(), std::memory_order_release);
+            auto session_ptr = session;
+            target->get_executor()->post([target, session_ptr, owns_flush]() {
+                target->on_tcp_session_migrated(session_ptr, owns_flush);
+            });
+#else
+            (void) session;
+            (void) target;
+#endif
+        }
+
+        void service_thread::on_tcp_session_migrated(const std::shared_ptr<tcp_session> &session, bool owns_flush) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            auto data = session->socket_data_;
+            // 关联失败时会关闭socket并从会话表移除 , 先加入
+            add_tcp_session(data->sock_fd(), session);
+            if (!io_impl_->attach_socket(data))
+                return;
+            session->cancel_timeout_timer();
+            session->check_timeout();
+            // 迁移前后投递的包都还在队列里 , 没有在途的flush时补发一次
+            if (owns_flush || !data->is_flush_scheduled_.exchange(true, std::memory_order_acq_rel))
+                io_impl_->post_flush(data.get());
+#else
+            (void) session;
+            (void) owns_flush;
+#endif
+        }
+
+        timer_id service_thread::run_after(unsigned int delay_ms, timer_callback callback) {
+            return add_timer(delay_ms, 0, std::move(callback));
+        }
+
+        timer_id service_thread::run_every(unsigned int interval_ms, timer_callback callback) {
+            return add_timer(interval_ms, (std::max)(interval_ms, 1u), std::move(callback));
+        }
+
+        timer_id service_thread::add_timer(unsigned int delay_ms, unsigned int interval_ms, timer_callback &&callback) {
+            timer_id id = next_timer_id_.fetch_add(1, std::memory_order_relaxed);
+            // 到期时间按调用时计算 , 不受投递延迟影响
+            int64_t expire_tick = to_tick(std::chrono::steady_clock::now()) + delay_ms;
+            auto func = std::make_shared<timer_callback>(std::move(callback));
+            task_executor_->post([this, id, expire_tick, interval_ms, func]() {
+                timer_wheel_.add(id, expire_tick, interval_ms, std::move(*func));
+            });
+            return id;
+        }
+
+        void service_thread::cancel_timer(timer_id id) {
+            task_executor_->post([this, id]() {
+                timer_wheel_.cancel(id);
+            });
+        }
+
         void service_thread::run(std::shared_ptr<bool> is_run) {
+            running_.store(true, std::memory_order_release);
             thread_ = std::make_shared<std::thread>([is_run, this]() {
                 thread_id_ = current_thread::tid();
+                // 先绑定再分配本线程的缓存 , 之后的内存都落在所在节点上
+                if (!cpus_.empty() && !spdnet::base::numa::bind_current_thread(cpus_))
+                    std::cerr << "bind service thread cpu error ." << std::endl;
+                if (numa_node_ >= 0)
+                    spdnet::base::numa::prefer_node(numa_node_);
                 task_executor_->set_thread_id(thread_id_);
+                auto &metrics = io_impl_->metrics();
+                spdnet::base::buffer_pool::set_thread_stats(&metrics.buffer_stats);
+#if defined(SPDNET_PLATFORM_LINUX)
+                io_impl_->bind_buffer_arena(true);
+#endif
+                auto now = std::chrono::steady_clock::now();
+                auto next_trim_time = now;
+                auto load_begin_time = now;
+                std::chrono::steady_clock::duration busy_time(0);
+                // 忙轮询的当前时长和截止时间
+                const std::chrono::microseconds max_spin_window(busy_poll_us_);
+                std::chrono::microseconds spin_window(busy_poll_us_);
+                auto spin_until = now;
+                timer_wheel_.advance(to_tick(now));
                 while (*is_run) {
-                    // run io
-                    io_impl_->run_once(wait_timeout_ms_);
+                    // run io , 有定时器时最多等到下一个定时器到期
+                    bool spinning = busy_poll_us_ > 0 && now < spin_until;
+                    unsigned int timeout_ms = wait_timeout_ms_;
+                    if (spinning || task_executor_->has_pending_tasks())
+                        timeout_ms = 0;
+                    else if (!timer_wheel_.empty())
+                        timeout_ms = static_cast<unsigned int>(timer_wheel_.next_timeout(
+                                to_tick(std::chrono::steady_clock::now()), wait_timeout_ms_));
+                    if (busy_poll_us_ > 0 && spinning != spinning_.load(std::memory_order_relaxed)) {
+                        spinning_.store(spinning, std::memory_order_relaxed);
+                        // 停止轮询后 , 之前跳过唤醒的task要在阻塞前发现
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        if (!spinning && task_executor_->has_pending_tasks())
+                            timeout_ms = 0;
+                    }
+                    size_t num_events = io_impl_->run_once(timeout_ms);
+                    metrics.on_wait(num_events);
 
                     clear_wakeup_flag();
 
                     // do task
-                    task_executor_->run();
+                    bool has_work = num_events > 0 || task_executor_->has_pending_tasks();
+                    size_t num_tasks = task_executor_->run();
+
+                    // do timer
+                    auto wait_begin = now;
+                    now = std::chrono::steady_clock::now();
+                    timer_wheel_.advance(to_tick(now));
+
+                    if (busy_poll_us_ > 0 && has_work) {
+                        if (timeout_ms > 0) {
+                            // 阻塞不久就来了事件 , 说明轮询得不够久 ; 很久才来则说明事件稀疏 , 不值得轮询
+                            if (io_impl_->last_wakeup_time() - wait_begin <= max_spin_window)
+                                spin_window = (std::min)((std::max)(spin_window * 2, std::chrono::microseconds(10)),
+                                                         max_spin_window);
+                            else
+                                spin_window /= 2;
+                        }
+                        spin_until = now + spin_window;
+                    } else if (spinning && !has_work) {
+                        // 空转时让出cpu , 与其它线程共用cpu时不至于占满时间片 ; 独占cpu时几乎没有开销
+                        std::this_thread::yield();
+                    }
+
                     // release channel
                     channel_collector_->release_channel();
+
+                    // 空转的轮询不算忙碌
+                    auto loop_time = now - io_impl_->last_wakeup_time();
+                    if (has_work || !spinning)
+                        busy_time += loop_time;
+                    if (has_work)
+                        metrics.on_loop(num_tasks, static_cast<uint64_t>(
+                                std::chrono::duration_cast<std::chrono::microseconds>(loop_time).count()));
+                    auto sample_time = now - load_begin_time;
+                    if (SPDNET_PREDICT_FALSE(sample_time >= std::chrono::milliseconds(
+                            static_cast<unsigned int>(load_sample_interval_ms)))) {
+                        auto sample = (std::min)(static_cast<unsigned int>(busy_time * 1000 / sample_time), 1000u);
+                        load_.store((load_.load(std::memory_order_relaxed) + sample) / 2, std::memory_order_relaxed);
+                        busy_time = std::chrono::steady_clock::duration(0);
+                        load_begin_time = now;
+                    }
+
+                    if (SPDNET_PREDICT_FALSE(now >= next_trim_time)) {
+                        const std::chrono::milliseconds trim_interval(static_cast<unsigned int>(buffer_trim_interval_ms));
+                        auto &pool = spdnet::base::buffer_pool::instance();
+                        pool.trim_thread_cache();
+                        pool.trim_depot(now, trim_interval);
+                        next_trim_time = now + trim_interval;
+                    }
                 }
+                // 退出前执行已经投递的task , 之后投递方通过is_running得知循环已退出
+                running_.store(false, std::memory_order_seq_cst);
+                task_executor_->run();
+                channel_collector_->release_channel();
+#if defined(SPDNET_PLATFORM_LINUX)
+                io_impl_->on_loop_exit();
+                io_impl_->bind_buffer_arena(false);
+#endif
+                spdnet::base::buffer_pool::set_thread_stats(nullptr);
             });
         }
     }
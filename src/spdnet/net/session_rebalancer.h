@@ -0,0 +1,62 @@
+#ifndef SPDNET_NET_SESSION_REBALANCER_H_
+#define SPDNET_NET_SESSION_REBALANCER_H_
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/net/service_thread.h>
+
+namespace spdnet {
+    namespace net {
+        class event_service;
+
+        struct rebalance_options {
+            // 检查各线程负载的间隔
+            unsigned int interval_ms{1000};
+            // 最忙的线程load(千分比)达到这个值才考虑迁移
+            unsigned int min_hot_load{700};
+            // 最忙和最闲的线程load至少相差这么多
+            unsigned int min_load_gap{300};
+            // 每轮最多迁移的会话数
+            size_t max_moves_per_round{8};
+        };
+
+        /*
+         * 定期比较event_service各io线程的load , 把最忙线程上的一部分会话迁移到最闲的线程 。
+         * 按上一轮以来各会话收发的字节数估计负载 , 从大到小挑选不超过负载差一半的会话 ,
+         * 单个会话就占满一个线程时不会移动它 , 而是把同线程的其它会话移走 。
+         * 使用单独的线程 , 仅epoll后端支持迁移 。
+        **/
+        class session_rebalancer : public spdnet::base::noncopyable {
+        public:
+            explicit session_rebalancer(event_service &service, const rebalance_options &options = rebalance_options());
+
+            ~session_rebalancer();
+
+            void start();
+
+            void stop();
+
+            // 立即检查一次 , 返回是否安排了迁移
+            bool rebalance_once();
+
+        private:
+            void pick_sessions(const std::shared_ptr<service_thread> &hot, const std::shared_ptr<service_thread> &cold,
+                               unsigned int move_load);
+
+        private:
+            event_service &service_;
+            rebalance_options options_;
+            std::mutex mutex_;
+            std::condition_variable cond_;
+            bool running_{false};
+            std::thread thread_;
+        };
+    }
+}
+
+#include <spdnet/net/session_rebalancer.ipp>
+
+#endif  // SPDNET_NET_SESSION_REBALANCER_H_
@@ -0,0 +1,116 @@
+#ifndef SPDNET_NET_SESSION_REBALANCER_IPP_
+#define SPDNET_NET_SESSION_REBALANCER_IPP_
+
+#include <spdnet/net/session_rebalancer.h>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <spdnet/net/event_service.h>
+#include <spdnet/net/tcp_session.h>
+
+namespace spdnet {
+    namespace net {
+
+        session_rebalancer::session_rebalancer(event_service &service, const rebalance_options &options)
+                : service_(service), options_(options) {
+        }
+
+        session_rebalancer::~session_rebalancer() {
+            stop();
+        }
+
+        void session_rebalancer::start() {
+            std::lock_guard<std::mutex> lck(mutex_);
+            if (running_)
+                return;
+            running_ = true;
+            thread_ = std::thread([this]() {
+                std::unique_lock<std::mutex> lck(mutex_);
+                while (running_) {
+                    cond_.wait_for(lck, std::chrono::milliseconds(options_.interval_ms));
+                    if (!running_)
+                        break;
+                    lck.unlock();
+                    rebalance_once();
+                    lck.lock();
+                }
+            });
+        }
+
+        void session_rebalancer::stop() {
+            {
+                std::lock_guard<std::mutex> lck(mutex_);
+                running_ = false;
+            }
+            cond_.notify_all();
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+        bool session_rebalancer::rebalance_once() {
+            std::vector<std::shared_ptr<service_thread>> threads = service_.get_service_threads();
+            if (threads.size() < 2)
+                return false;
+
+            std::shared_ptr<service_thread> hot = threads.front();
+            std::shared_ptr<service_thread> cold = threads.front();
+            for (const auto &thread : threads) {
+                if (thread->load() > hot->load())
+                    hot = thread;
+                if (thread->load() < cold->load())
+                    cold = thread;
+            }
+            unsigned int hot_load = hot->load();
+            unsigned int cold_load = cold->load();
+            if (hot_load < options_.min_hot_load || hot_load < cold_load + options_.min_load_gap)
+                return false;
+            if (!hot->get_impl_ref().support_migration() || !cold->get_impl_ref().support_migration())
+                return false;
+
+            // 移走负载差的一半 , 两边大致持平
+            pick_sessions(hot, cold, (hot_load - cold_load) / 2);
+            return true;
+        }
+
+        void session_rebalancer::pick_sessions(const std::shared_ptr<service_thread> &hot,
+                                               const std::shared_ptr<service_thread> &cold, unsigned int move_load) {
+            size_t max_moves = options_.max_moves_per_round;
+            hot->get_executor()->post([hot, cold, move_load, max_moves]() {
+                struct candidate {
+                    std::shared_ptr<tcp_session> session_;
+                    uint64_t bytes_;
+                };
+                std::vector<candidate> candidates;
+                uint64_t total_bytes = 0;
+                hot->for_each_tcp_session([&candidates, &total_bytes](const std::shared_ptr<tcp_session> &session) {
+                    auto &data = *session->socket_data_;
+                    uint64_t bytes = data.io_bytes_ - data.last_balance_io_bytes_;
+                    data.last_balance_io_bytes_ = data.io_bytes_;
+                    total_bytes += bytes;
+                    if (bytes > 0)
+                        candidates.push_back(candidate{session, bytes});
+                });
+                unsigned int hot_load = hot->load();
+                if (total_bytes == 0 || hot_load == 0)
+                    return;
+
+                uint64_t budget = total_bytes * move_load / hot_load;
+                std::sort(candidates.begin(), candidates.end(), [](const candidate &a, const candidate &b) {
+                    return a.bytes_ > b.bytes_;
+                });
+                size_t moves = 0;
+                for (const auto &item : candidates) {
+                    if (moves >= max_moves)
+                        break;
+                    if (item.bytes_ > budget)
+                        continue;
+                    hot->migrate_tcp_session(item.session_, cold);
+                    budget -= item.bytes_;
+                    moves++;
+                }
+            });
+        }
+    }
+}
+
+#endif // SPDNET_NET_SESSION_REBALANCER_IPP_
@@ -2,12 +2,20 @@
 #define SPDNET_NET_SOCKET_DATA_H_
 
 #include <memory>
+#include <atomic>
 #include <deque>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <mutex>
 #include <functional>
+#include <sys/types.h>
 #include <spdnet/base/platform.h>
 #include <spdnet/base/noncopyable.h>
 #include <spdnet/base/buffer.h>
-#include <spdnet/base/spin_lock.h>
+#include <spdnet/base/chain_buffer.h>
+#include <spdnet/base/mpsc_queue.h>
 #include <spdnet/net/socket_ops.h>
 
 
@@ -19,31 +27,46 @@ namespace spdnet {
             class iocp_send_channel;
 #else
 
-            class epoll_socket_channel;
+            class channel;
 
 #endif
         }
+        // 分散发送的一个数据片段 , 多个片段作为一个逻辑包按顺序发送
+        struct send_fragment {
+            const char *data;
+            size_t len;
+        };
+
         struct socket_data : public spdnet::base::noncopyable {
         public:
             using ptr = std::shared_ptr<socket_data>;
-            using tcp_data_callback = std::function<size_t(const char *, size_t len)>;
+            // data指向session自己的接收缓冲区 , 回调期间可以原地修改(如websocket去掩码)
+            using tcp_data_callback = std::function<size_t(char *, size_t len)>;
             using tcp_disconnect_callback = std::function<void()>;
             using tcp_send_complete_callback = std::function<void()>;
         public:
             socket_data(sock_t fd, bool is_server_side)
-                    : fd_(fd), is_server_side_(is_server_side) {
+                    : fd_(fd), is_server_side_(is_server_side),
+                      last_recv_time_(std::chrono::steady_clock::now()), last_send_time_(last_recv_time_) {
 
             }
 
             virtual ~socket_data() {
-                for (auto &packet : send_packet_list_) {
+                while (spdnet::base::mpsc_node *node = send_queue_.pop()) {
+                    auto packet_node = static_cast<send_packet_node *>(node);
+                    delete packet_node->packet_.buffer_;
+                    delete packet_node;
+                }
+                if (SPDNET_PREDICT_FALSE(has_inflight_zerocopy()))
+                    abandon_zerocopy_packets();
+                for (auto &packet : pending_packet_list_) {
                     delete packet.buffer_;
                 }
-                for (auto packet : pending_packet_list_) {
+                for (auto &packet : zerocopy_packet_list_) {
                     delete packet.buffer_;
                 }
-                send_packet_list_.clear();
                 pending_packet_list_.clear();
+                zerocopy_packet_list_.clear();
             }
 
             void set_disconnect_callback(tcp_disconnect_callback &&callback) {
@@ -84,13 +107,48 @@ namespace spdnet {
                 has_closed_ = true;
                 is_can_write_ = false;
 
+                /*
+                 * 内核只是固定了零拷贝发送的内存页 , 并没有拷贝 , 通知到达前这些内存不能被复用 ,
+                 * 关闭后内核也会继续发送队列里的数据 。这时socket保持打开 , 由后端读取错误队列 ,
+                 * 通知到齐后调用close_lingering_fd ; 会话已经断开 , 这些包的完成回调不再调用 。
+                **/
+                if (SPDNET_PREDICT_FALSE(has_inflight_zerocopy())) {
+                    for (auto &packet : zerocopy_packet_list_)
+                        packet.callback_ = nullptr;
+                    for (auto &packet : pending_packet_list_)
+                        packet.callback_ = nullptr;
+                    return;
+                }
+                socket_ops::close_socket(fd_);
+            }
+
+            // 还有MSG_ZEROCOPY发送没有收到内核的完成通知
+            bool has_inflight_zerocopy() const {
+                return zerocopy_done_seq_ != zerocopy_next_seq_;
+            }
+
+            // close时因零拷贝保持打开的socket , 在通知到齐或者事件循环退出时关闭
+            void close_lingering_fd() {
                 socket_ops::close_socket(fd_);
             }
 
         public:
+            /*
+             * 待发送的数据包 。数据要么在从buffer_pool分配的buffer_里 ,
+             * 要么是调用方交出所有权的内存 , 由holder_保证发送完成前一直有效 , 不做拷贝 ;
+             * 也可以是文件区间 , 由sendfile直接从页缓存发送 。
+            **/
             struct send_packet {
                 send_packet(spdnet::base::buffer *buf, tcp_send_complete_callback &&callback)
-                        : buffer_(buf), callback_(std::move(callback)) {}
+                        : buffer_(buf), data_(buf->get_data_ptr()), length_(buf->get_length()),
+                          callback_(std::move(callback)) {}
+
+                send_packet(std::shared_ptr<const void> holder, const char *data, size_t len,
+                            tcp_send_complete_callback &&callback)
+                        : holder_(std::move(holder)), data_(data), length_(len), callback_(std::move(callback)) {}
+
+                send_packet(int file_fd, off_t offset, size_t len, tcp_send_complete_callback &&callback)
+                        : length_(len), file_fd_(file_fd), file_offset_(offset), callback_(std::move(callback)) {}
 
                 send_packet(const send_packet &) = default;
 
@@ -100,29 +158,323 @@ namespace spdnet {
 
                 send_packet &operator=(send_packet &&) = default;
 
-                spdnet::base::buffer *buffer_;
+                const char *data() const { return data_; }
+
+                size_t length() const { return length_; }
+
+                bool is_file() const { return file_fd_ >= 0; }
+
+                void remove_length(size_t len) {
+                    if (SPDNET_PREDICT_FALSE(is_file()))
+                        file_offset_ += static_cast<off_t>(len);
+                    else
+                        data_ += len;
+                    length_ -= len;
+                }
+
+                spdnet::base::buffer *buffer_{nullptr};
+                std::shared_ptr<const void> holder_;
+                const char *data_{nullptr};
+                size_t length_{0};
+                int file_fd_{-1};
+                off_t file_offset_{0};
+                // 有部分数据以MSG_ZEROCOPY发送过 , 发完后要等到序号zerocopy_seq_的通知才能释放
+                bool zerocopy_pending_{false};
+                uint32_t zerocopy_seq_{0};
+                // 会话开启耗时跟踪时记录入队时间 , 否则为空 ; 已计入send_to_write后置send_attempted_
+                std::chrono::steady_clock::time_point enqueue_time_{};
+                bool send_attempted_{false};
                 tcp_send_complete_callback callback_;
             };
 
+            // 发送队列的节点 , 由发送线程分配 , io线程取出包后释放
+            struct send_packet_node : public spdnet::base::mpsc_node {
+                template<typename... Args>
+                explicit send_packet_node(Args &&... args)
+                        : packet_(std::forward<Args>(args)...) {}
+
+                send_packet packet_;
+            };
+
+            /*
+             * 把接收缓冲区里的数据交给data_callback_ , 只在io线程调用 。
+             * 先逐块回调 , 回调只处理了一部分且后面还有数据时 , 合并成连续内存再回调一次 。
+             * 回调返回的长度超出给定长度时返回false , 调用方应关闭连接 。
+            **/
+            template<typename Impl>
+            bool deliver_recv_data(Impl &impl) {
+                last_recv_time_ = impl.last_wakeup_time();
+                if (SPDNET_PREDICT_TRUE(!is_tracing_latency()))
+                    return do_deliver_recv_data(impl);
+                auto start = std::chrono::steady_clock::now();
+                bool result = do_deliver_recv_data(impl);
+                impl.metrics().latency.recv_to_callback.record(elapsed_ns(start));
+                return result;
+            }
+
+            // 发送线程读取 , 决定是否给新包记录入队时间
+            bool is_tracing_latency() const {
+                return trace_latency_.load(std::memory_order_relaxed);
+            }
+
+            /*
+             * 即将把pending_packet_list_前count个包写入socket , 记录其中开启了跟踪、第一次尝试写入的包从入队到现在的耗时 。
+             * 各后端在writev/sendmsg/sendfile或提交发送请求之前调用 。
+            **/
+            template<typename Impl>
+            void trace_send_attempt(Impl &impl, size_t count) {
+                if (SPDNET_PREDICT_TRUE(untried_traced_packets_ == 0))
+                    return;
+                auto now = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < count && i < pending_packet_list_.size() && untried_traced_packets_ > 0; i++) {
+                    auto &packet = pending_packet_list_[i];
+                    if (packet.enqueue_time_ == std::chrono::steady_clock::time_point() || packet.send_attempted_)
+                        continue;
+                    packet.send_attempted_ = true;
+                    untried_traced_packets_--;
+                    impl.metrics().latency.send_to_write.record(elapsed_ns(packet.enqueue_time_, now));
+                }
+            }
+
+        private:
+            template<typename Impl>
+            bool do_deliver_recv_data(Impl &impl) {
+                while (!recv_buffer_.empty() && data_callback_) {
+                    size_t front_len = recv_buffer_.front_length();
+                    size_t len = data_callback_(recv_buffer_.front_data(), front_len);
+                    if (SPDNET_PREDICT_FALSE(len > front_len))
+                        return false;
+                    io_bytes_ += len;
+                    recv_buffer_.remove_length(impl, len);
+                    if (SPDNET_PREDICT_TRUE(len == front_len))
+                        continue;
+                    if (recv_buffer_.front_length() == recv_buffer_.get_length() || !data_callback_)
+                        break;
+                    size_t total_len = recv_buffer_.get_length();
+                    len = data_callback_(recv_buffer_.linearize(impl), total_len);
+                    if (SPDNET_PREDICT_FALSE(len > total_len))
+                        return false;
+                    io_bytes_ += len;
+                    recv_buffer_.remove_length(impl, len);
+                    break;
+                }
+                return true;
+            }
+
+            static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start,
+                                       std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now()) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+                return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+            }
+
+        public:
+
+            bool is_zerocopy_packet(const send_packet &packet) const {
+                return zerocopy_threshold_ > 0 && !packet.is_file() && packet.length() >= zerocopy_threshold_;
+            }
+
+            /*
+             * 任意线程把用next_串好的[first, last]追加到发送队列 ,
+             * 返回true表示之前没有安排flush , 调用方需要向io线程投递一次flush 。
+            **/
+            bool push_send_packets(send_packet_node *first, send_packet_node *last) {
+                send_queue_.push(first, last);
+                return !is_flush_scheduled_.exchange(true, std::memory_order_acq_rel);
+            }
+
+            // io线程执行投递的flush前调用 , 此后再入队的包会重新安排flush
+            void clear_flush_scheduled() {
+                is_flush_scheduled_.exchange(false, std::memory_order_acq_rel);
+            }
+
+            /*
+             * io线程发现暂时没有可发送的包时调用 , 释放flush状态 。
+             * 返回true表示释放前又有包入队且没有其它线程安排flush , 由调用方继续发送 。
+            **/
+            bool release_flush() {
+                clear_flush_scheduled();
+                return !send_queue_.empty() && !is_flush_scheduled_.exchange(true, std::memory_order_acq_rel);
+            }
+
+            // 把其它线程新投递的包并入pending_packet_list_ , 只在io线程调用
+            template<typename Impl>
+            void merge_send_packets(Impl &impl) {
+                bool was_empty = pending_packet_list_.empty();
+                size_t merged_bytes = 0;
+                while (spdnet::base::mpsc_node *node = send_queue_.pop()) {
+                    auto packet_node = static_cast<send_packet_node *>(node);
+                    merged_bytes += packet_node->packet_.length();
+                    if (SPDNET_PREDICT_FALSE(packet_node->packet_.enqueue_time_ != std::chrono::steady_clock::time_point()))
+                        untried_traced_packets_++;
+                    pending_packet_list_.push_back(std::move(packet_node->packet_));
+                    delete packet_node;
+                }
+                pending_send_bytes_ += merged_bytes;
+                impl.metrics().pending_send_bytes.add(merged_bytes);
+                // 开始有数据等待发送 , 写超时从这里算起
+                if (was_empty && !pending_packet_list_.empty())
+                    last_send_time_ = impl.last_wakeup_time();
+            }
+
+            // 以func(data, len)依次取出待发送的内存片段 , 最多max_count个 , 遇到文件区间或零拷贝包时停止 , 返回片段数量
+            template<typename Func>
+            size_t prepare_send_packets(size_t max_count, Func &&func) const {
+                size_t count = 0;
+                for (const auto &packet : pending_packet_list_) {
+                    if (count >= max_count || packet.is_file() || is_zerocopy_packet(packet))
+                        break;
+                    func(packet.data(), packet.length());
+                    count++;
+                }
+                return count;
+            }
+
+            /*
+             * 从pending_packet_list_移除已发送完的len字节 , 回收buffer并回调 。
+             * 零拷贝发送的包 , 以及排在它之后的包(保证回调顺序) , 转入zerocopy_packet_list_等待内核通知 。
+             * 返回true表示最后一个包只发送了一部分 。
+            **/
+            template<typename Impl>
+            bool remove_sent_packets(Impl &impl, size_t len) {
+                io_bytes_ += len;
+                if (len > 0)
+                    last_send_time_ = impl.last_wakeup_time();
+                // 关闭时已经整体扣除 , 之后完成的发送不再重复扣
+                size_t counted = (std::min)(len, pending_send_bytes_);
+                pending_send_bytes_ -= counted;
+                impl.metrics().pending_send_bytes.sub(counted);
+                impl.metrics().bytes_out.add(len);
+                while (!pending_packet_list_.empty()) {
+                    auto &packet = pending_packet_list_.front();
+                    if (SPDNET_PREDICT_FALSE(packet.length() > len)) {
+                        packet.remove_length(len);
+                        return true;
+                    }
+                    len -= packet.length();
+                    if (SPDNET_PREDICT_FALSE(packet.zerocopy_pending_ || !zerocopy_packet_list_.empty())) {
+                        packet.zerocopy_seq_ = zerocopy_next_seq_ - 1;
+                        zerocopy_packet_list_.push_back(std::move(packet));
+                        pending_packet_list_.pop_front();
+                        continue;
+                    }
+                    complete_front_packet(impl, pending_packet_list_);
+                }
+                return false;
+            }
+
+            // socket关闭时从所在线程的统计里扣除还没发送的字节
+            template<typename Impl>
+            void drop_pending_send_bytes(Impl &impl) {
+                impl.metrics().pending_send_bytes.sub(pending_send_bytes_);
+                pending_send_bytes_ = 0;
+            }
+
+            // 一次MSG_ZEROCOPY发送成功 , 内核按调用顺序为其分配通知序号
+            void on_zerocopy_sent() {
+                pending_packet_list_.front().zerocopy_pending_ = true;
+                zerocopy_next_seq_++;
+            }
+
+            // 内核通知序号[lo, hi]的零拷贝发送已完成 , 释放之前发送的包
+            template<typename Impl>
+            void on_zerocopy_complete(Impl &impl, uint32_t lo, uint32_t hi) {
+                if (lo != zerocopy_done_seq_) {
+                    // 通知可能乱序 , 等前面的到达后再合并
+                    zerocopy_ranges_.emplace_back(lo, hi);
+                    return;
+                }
+                zerocopy_done_seq_ = hi + 1;
+                bool merged = true;
+                while (merged) {
+                    merged = false;
+                    for (auto iter = zerocopy_ranges_.begin(); iter != zerocopy_ranges_.end(); ++iter) {
+                        if (iter->first == zerocopy_done_seq_) {
+                            zerocopy_done_seq_ = iter->second + 1;
+                            zerocopy_ranges_.erase(iter);
+                            merged = true;
+                            break;
+                        }
+                    }
+                }
+                while (!zerocopy_packet_list_.empty()
+                       && static_cast<int32_t>(zerocopy_packet_list_.front().zerocopy_seq_ - zerocopy_done_seq_) < 0) {
+                    complete_front_packet(impl, zerocopy_packet_list_);
+                }
+            }
+
+        private:
+            /*
+             * 再也收不到通知时(事件循环已退出) , 内核可能仍在发送这些包 , 它们的内存不能交还分配器 ,
+             * 只能放弃 。放进一个不释放的列表 , 而不是直接泄漏 。
+            **/
+            void abandon_zerocopy_packets() {
+                static std::mutex mutex;
+                static auto abandoned = new std::deque<send_packet>();
+                std::lock_guard<std::mutex> lck(mutex);
+                if (!pending_packet_list_.empty() && pending_packet_list_.front().zerocopy_pending_) {
+                    abandoned->push_back(std::move(pending_packet_list_.front()));
+                    pending_packet_list_.pop_front();
+                }
+                for (auto &packet : zerocopy_packet_list_)
+                    abandoned->push_back(std::move(packet));
+                zerocopy_packet_list_.clear();
+            }
+
+            template<typename Impl>
+            static void complete_front_packet(Impl &impl, std::deque<send_packet> &packet_list) {
+                auto &packet = packet_list.front();
+                if (SPDNET_PREDICT_FALSE(packet.enqueue_time_ != std::chrono::steady_clock::time_point()))
+                    impl.metrics().latency.send_to_complete.record(elapsed_ns(packet.enqueue_time_));
+                if (packet.buffer_ != nullptr) {
+                    packet.buffer_->clear();
+                    impl.recycle_buffer(packet.buffer_);
+                }
+                auto callback = std::move(packet.callback_);
+                packet_list.pop_front();
+                if (callback)
+                    callback();
+            }
+
         public:
             sock_t fd_;
             bool is_server_side_{false};
             tcp_disconnect_callback disconnect_callback_;
             tcp_data_callback data_callback_;
-            spdnet::base::buffer recv_buffer_;
+            spdnet::base::chain_buffer recv_buffer_;
+            // 连续读满时一次读取准备的最大空间
             size_t max_recv_buffer_size_ = 64 * 1024;
-            std::deque<send_packet> send_packet_list_;
+            spdnet::base::mpsc_queue send_queue_;
             std::deque<send_packet> pending_packet_list_;
-            spdnet::base::spin_lock send_guard_;
+            std::deque<send_packet> zerocopy_packet_list_;
+            std::vector<std::pair<uint32_t, uint32_t>> zerocopy_ranges_;
+            size_t zerocopy_threshold_{0};
+            uint32_t zerocopy_next_seq_{0};
+            uint32_t zerocopy_done_seq_{0};
+            std::atomic<bool> is_flush_scheduled_{false};
+            // 当前负责该socket的io后端 , 迁移时改变 ; 投递到旧后端的flush据此转投
+            std::atomic<const void *> owner_impl_{nullptr};
+            // 迁移时有flush正在投递 , 它可能落到旧线程 , 在新线程执行前保持socket_data存活
+            ptr migration_pin_;
+            // 已处理的收发字节数 , 只在io线程访问 , 用于估计各会话的负载
+            uint64_t io_bytes_{0};
+            uint64_t last_balance_io_bytes_{0};
+            // 已并入pending_packet_list_、还没写入socket的字节数 , 只在io线程访问
+            size_t pending_send_bytes_{0};
+            // 最近读到数据、发送有进展的时间 , 取io线程本轮的唤醒时间 , 不另读时钟 ; 用于会话的超时检测
+            std::chrono::steady_clock::time_point last_recv_time_;
+            std::chrono::steady_clock::time_point last_send_time_;
+            // 是否统计该会话的收发耗时 , 可在任意线程修改
+            std::atomic<bool> trace_latency_{false};
+            // pending_packet_list_里记录了入队时间、还没尝试写入的包数 , 只在io线程访问
+            size_t untried_traced_packets_{0};
             volatile bool has_closed_{false};
-            volatile bool is_post_flush_{false};
             volatile bool is_can_write_{true};
 
 #if defined(SPDNET_PLATFORM_WINDOWS)
             std::shared_ptr<detail::iocp_recv_channel> recv_channel_;
             std::shared_ptr<detail::iocp_send_channel> send_channel_;
 #else
-            std::shared_ptr<detail::epoll_socket_channel> channel_;
+            std::shared_ptr<detail::channel> channel_;
 #endif
         };
     }
@@ -5,6 +5,36 @@
 #include <string>
 #include <iostream>
 
+#if defined(SPDNET_PLATFORM_LINUX)
+
+#include <linux/filter.h>
+#include <linux/errqueue.h>
+
+// 旧的头文件里没有MSG_ZEROCOPY相关的定义 , 运行时由setsockopt判断内核是否支持
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+#endif
+
 namespace spdnet {
     namespace net {
         namespace socket_ops {
@@ -37,6 +67,55 @@ namespace spdnet {
                 return err != SPDNET_SOCKET_ERROR;
             }
 
+#if defined(SPDNET_PLATFORM_LINUX)
+
+            inline int socket_reuse_port(sock_t fd) {
+                int on = 1;
+                return ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char *) &on, sizeof(on));
+            }
+
+            // 按收包cpu在reuse port组内选择socket : index = cpu % group_size
+            inline int attach_reuse_port_cbpf(sock_t fd, uint32_t group_size) {
+                struct sock_filter code[] = {
+                        {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+                        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size},
+                        {BPF_RET | BPF_A, 0, 0, 0},
+                };
+                struct sock_fprog prog;
+                prog.len = sizeof(code) / sizeof(code[0]);
+                prog.filter = code;
+                return ::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+            }
+
+            inline int socket_zerocopy(sock_t fd) {
+                int on = 1;
+                return ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, (const char *) &on, sizeof(on));
+            }
+
+            // 最近一次处理该连接收包的cpu , 取不到时返回-1
+            inline int socket_incoming_cpu(sock_t fd) {
+                int cpu = -1;
+                socklen_t len = sizeof(cpu);
+                if (::getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+                    return -1;
+                return cpu;
+            }
+
+            /*
+             * 收包时在网卡队列上忙等最多usec微秒 , 并尽量让软中断让位给忙等 。
+             * 超过net.core.busy_read需要CAP_NET_ADMIN , 失败返回-1 ; SO_PREFER_BUSY_POLL需要5.11以上 , 不支持时忽略 。
+            **/
+            inline int socket_busy_poll(sock_t fd, unsigned int usec) {
+                int value = static_cast<int>(usec);
+                if (::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) < 0)
+                    return -1;
+                int on = 1;
+                ::setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on));
+                return 0;
+            }
+
+#endif
+
             inline int socket_send_buf_size(sock_t fd, int size) {
                 return ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char *) &size, sizeof(size));
             }
@@ -2,52 +2,82 @@
 #define SPDNET_NET_TASK_EXECUTOR_H
 
 #include <iostream>
-#include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <spdnet/base/platform.h>
+#include <spdnet/base/mpsc_queue.h>
+#include <spdnet/base/unique_function.h>
 #include <spdnet/net/current_thread.h>
 #include <spdnet/net/wakeup_base.h>
 
 namespace spdnet {
     namespace net {
-        using task_functor = std::function<void()>;
+        /*
+         * 投递的lambda通常捕获若干shared_ptr , 64字节的内部存储可以容纳 , functor本身不必堆分配 。
+         * 跨线程投递时functor存放在队列节点里 , 节点复用后这条路径才真正没有分配 。
+        **/
+        using task_functor = spdnet::base::unique_function<void(), 64>;
 
         class task_executor : public spdnet::base::noncopyable {
         public:
+            // 每轮循环最多执行的跨线程task数量 , 避免生产者持续投递时饿死io
+            static constexpr size_t max_async_tasks_per_run = 4096;
+
             task_executor(wakeup_base *wakeup)
                     : wakeup_(wakeup) {
 
             }
 
+            ~task_executor() {
+                while (spdnet::base::mpsc_node *node = async_tasks_.pop())
+                    delete static_cast<task_node *>(node);
+                delete_node_list(recycled_nodes_.exchange(nullptr, std::memory_order_acquire));
+            }
+
             void post(task_functor &&task, bool is_try_immediate = true) {
-                if (is_try_immediate && is_in_io_thread()) {
+                if (!is_in_io_thread()) {
+                    async_tasks_.push(alloc_node(std::move(task)));
+                    wakeup_->wakeup();
+                } else if (is_try_immediate) {
                     // immediate exec
                     task();
                 } else {
-                    if (!is_in_io_thread()) {
-                        std::lock_guard<std::mutex> lck(task_mutex_);
-                        async_tasks.emplace_back(std::move(task));
-                    } else {
-                        sync_tasks.emplace_back(std::move(task));
-                    }
-                    wakeup_->wakeup();
+                    // 本轮循环末尾执行 , 不需要唤醒
+                    sync_tasks.emplace_back(std::move(task));
                 }
             }
 
-            void run() {
-                // 执行其它线程投递的task
-                {
-                    std::lock_guard<std::mutex> lck(task_mutex_);
-                    tmp_async_tasks.swap(async_tasks);
-                }
-                for (auto &task : tmp_async_tasks) {
-                    task();
-                }
-                tmp_async_tasks.clear();
-                // ִ执行本线程投递的task
+            // 返回执行的task数量
+            size_t run() {
+                // 执行其它线程投递的task , 执行完的节点串起来一次性还给投递方
+                task_node *first = nullptr;
+                task_node *last = nullptr;
+                size_t count = async_tasks_.drain([&first, &last](spdnet::base::mpsc_node *node) {
+                    auto task = static_cast<task_node *>(node);
+                    task->task_();
+                    // 尽早释放捕获的资源
+                    task->task_ = nullptr;
+                    task->free_next_ = first;
+                    first = task;
+                    if (last == nullptr)
+                        last = task;
+                }, max_async_tasks_per_run);
+                if (first != nullptr)
+                    recycle_nodes(first, last);
+                // 执行本线程投递的task
                 tmp_sync_tasks.swap(sync_tasks);
                 for (auto &task : tmp_sync_tasks) {
                     task();
                 }
+                count += tmp_sync_tasks.size();
                 tmp_sync_tasks.clear();
+                return count;
+            }
+
+            // 仅io线程调用 , 有待执行的task时io等待不应阻塞
+            bool has_pending_tasks() const {
+                return !sync_tasks.empty() || !async_tasks_.empty();
             }
 
             void set_thread_id(thread_id_t id) {
@@ -59,11 +89,86 @@ namespace spdnet {
             }
 
         private:
+            struct task_node : public spdnet::base::mpsc_node {
+                task_functor task_;
+                task_node *free_next_{nullptr};
+            };
+
+            /*
+             * 跨线程投递的节点缓存 。每个投递线程有自己的缓存 , 取节点不需要同步 ;
+             * io线程把执行完的节点压入recycled_nodes_ , 投递线程缓存空了时整体交换取走 。
+             * 只有整体取走 , 没有单个弹出 , 所以压栈的CAS没有ABA问题 。
+            **/
+            struct node_cache {
+                // 超出的节点在补充时直接释放 , 避免突发投递后长期占用内存
+                static constexpr size_t max_nodes = 1024;
+
+                ~node_cache() {
+                    delete_node_list(head_);
+                }
+
+                task_node *head_{nullptr};
+                size_t size_{0};
+            };
+
+            static node_cache &thread_node_cache() {
+                static thread_local node_cache cache;
+                return cache;
+            }
+
+            task_node *alloc_node(task_functor &&task) {
+                node_cache &cache = thread_node_cache();
+                if (SPDNET_PREDICT_FALSE(cache.head_ == nullptr))
+                    refill_cache(cache);
+                task_node *node = cache.head_;
+                if (SPDNET_PREDICT_TRUE(node != nullptr)) {
+                    cache.head_ = node->free_next_;
+                    cache.size_--;
+                } else {
+                    node = new task_node;
+                }
+                node->task_ = std::move(task);
+                return node;
+            }
+
+            void refill_cache(node_cache &cache) {
+                if (recycled_nodes_.load(std::memory_order_relaxed) == nullptr)
+                    return;
+                task_node *node = recycled_nodes_.exchange(nullptr, std::memory_order_acquire);
+                while (node != nullptr) {
+                    task_node *next = node->free_next_;
+                    if (cache.size_ < node_cache::max_nodes) {
+                        node->free_next_ = cache.head_;
+                        cache.head_ = node;
+                        cache.size_++;
+                    } else {
+                        delete node;
+                    }
+                    node = next;
+                }
+            }
+
+            // 仅io线程调用 , [first, last]已经用free_next_串好
+            void recycle_nodes(task_node *first, task_node *last) {
+                task_node *head = recycled_nodes_.load(std::memory_order_relaxed);
+                do {
+                    last->free_next_ = head;
+                } while (!recycled_nodes_.compare_exchange_weak(head, first, std::memory_order_release,
+                                                                std::memory_order_relaxed));
+            }
+
+            static void delete_node_list(task_node *node) {
+                while (node != nullptr) {
+                    task_node *next = node->free_next_;
+                    delete node;
+                    node = next;
+                }
+            }
+
             thread_id_t thread_id_{0};
-            std::mutex task_mutex_;
-            std::vector<task_functor> async_tasks;
+            spdnet::base::mpsc_queue async_tasks_;
+            std::atomic<task_node *> recycled_nodes_{nullptr};
             std::vector<task_functor> sync_tasks;
-            std::vector<task_functor> tmp_async_tasks;
             std::vector<task_functor> tmp_sync_tasks;
             wakeup_base *wakeup_{nullptr};
         };
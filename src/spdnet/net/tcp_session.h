@@ -2,13 +2,17 @@
 #define SPDNET_NET_TCP_SESSION_H_
 
 #include <memory>
+#include <string>
 #include <deque>
+#include <atomic>
+#include <vector>
 #include <functional>
 #include <spdnet/base/noncopyable.h>
 #include <spdnet/base/buffer.h>
 #include <spdnet/base/spin_lock.h>
 #include <spdnet/base/platform.h>
 #include <spdnet/net/socket_data.h>
+#include <spdnet/net/timer_wheel.h>
 
 namespace spdnet {
     namespace net {
@@ -20,7 +24,9 @@ namespace spdnet {
 
             friend class event_service;
 
-            using tcp_data_callback = std::function<size_t(const char *, size_t len)>;
+            friend class session_rebalancer;
+
+            using tcp_data_callback = socket_data::tcp_data_callback;
             using tcp_disconnect_callback = std::function<void(std::shared_ptr<tcp_session>)>;
         public:
             inline tcp_session(sock_t fd, bool is_server_side, std::shared_ptr<service_thread> service_thread);
@@ -43,21 +49,111 @@ namespace spdnet {
                 socket_data_->set_no_delay();
             }
 
+            // 不小于threshold字节的包以MSG_ZEROCOPY发送 , 0表示关闭 ; 仅epoll后端支持 , 不支持时返回false
+            inline bool set_zerocopy_threshold(size_t threshold);
+
             inline void
             send(const char *data, size_t len, socket_data::tcp_send_complete_callback &&callback = nullptr);
 
+            // 以下重载接管调用方的内存 , 直接交给writev , 不再拷贝到内部buffer
+            inline void send(std::string &&data, socket_data::tcp_send_complete_callback &&callback = nullptr);
+
+            // 同一份数据广播给多个session时共享同一个string
+            inline void
+            send(std::shared_ptr<const std::string> data, socket_data::tcp_send_complete_callback &&callback = nullptr);
+
+            /*
+             * owner保证[data, data + len)在发送完成前有效 , 可以是带自定义deleter的shared_ptr 。
+             * 与拷贝的send区分命名 , 否则send(data, len, nullptr)会有歧义 。
+            **/
+            inline void send_owned(const char *data, size_t len, std::shared_ptr<const void> owner,
+                                   socket_data::tcp_send_complete_callback &&callback = nullptr);
+
+            // 多个片段拷贝进同一个buffer , 省去调用方先拼接成string
+            inline void send(const send_fragment *fragments, size_t count,
+                             socket_data::tcp_send_complete_callback &&callback = nullptr);
+
+            // 多个片段不拷贝 , 由owner保证有效 , 全部发送完成后回调一次
+            inline void send_owned(const send_fragment *fragments, size_t count, std::shared_ptr<const void> owner,
+                                   socket_data::tcp_send_complete_callback &&callback = nullptr);
+
+#if defined(SPDNET_PLATFORM_LINUX)
+
+            // 通过sendfile发送文件区间 , 与其它send按投递顺序交错 ; file_fd需保持打开直到回调或连接断开
+            inline void send_file(int file_fd, off_t offset, size_t len,
+                                  socket_data::tcp_send_complete_callback &&callback = nullptr);
+
+#endif
+
+
+            /*
+             * 超时检测 , 单位ms , 0表示不检测 , 超时后关闭连接并回调断开 。
+             * 收发时只记录本轮循环的时间 , 每个会话在本线程时间轮上只挂一个定时器 , 到期时按最近的收发时间重新挂上 ,
+             * 不会因为每个包都重置定时器 。
+            **/
+            // 超过ms没有收到也没有发出任何数据
+            inline void set_idle_timeout(unsigned int ms);
+
+            // 超过ms没有收到数据
+            inline void set_read_timeout(unsigned int ms);
+
+            // 有数据等待发送 , 但超过ms没有任何发送进展 , 比如对端不再读取 ; 最迟在超时后再过ms发现
+            inline void set_write_timeout(unsigned int ms);
+
+            /*
+             * 开启后统计该会话的收发耗时 , 汇总到所在线程的service_thread::latency_metrics 。
+             * 多个片段作为一个包发送时只跟踪最后一个片段 。可在任意线程调用 , 之后入队的包才被跟踪 。
+            **/
+            inline void set_latency_tracing(bool enable) {
+                socket_data_->trace_latency_.store(enable, std::memory_order_relaxed);
+            }
 
             inline sock_t sock_fd() const {
                 return socket_data_->sock_fd();
             }
 
+            // 会话当前所属的io线程 , 迁移后改变
+            inline service_thread *current_thread() const {
+                return service_thread_.load(std::memory_order_acquire);
+            }
+
+            /*
+             * 把会话迁移到target线程 , 未读的数据和待发送的包都随之转移 , 不会丢失或乱序 。
+             * 迁移在原线程本轮循环末尾异步进行 , 之后的回调都在target线程执行 。
+             * 仅epoll后端支持 , 不支持时返回false ; 会话在迁移前关闭时什么也不做 。
+            **/
+            inline bool migrate(std::shared_ptr<service_thread> target);
+
         public:
             inline static std::shared_ptr<tcp_session>
             create(sock_t fd, bool is_server_side, std::shared_ptr<service_thread> service_thread);
 
+        private:
+            inline void send_packet(socket_data::send_packet &&packet);
+
+            inline void post_flush();
+
+            // 在会话当前所属的线程执行task , 执行前发现会话已迁移则转投到新线程
+            inline void run_in_thread(std::function<void()> &&task, bool is_try_immediate = true);
+
+            inline void set_timeout(unsigned int tcp_session::*timeout, unsigned int ms);
+
+            // 检查各项超时 , 已超时则关闭连接 , 否则按最近的截止时间重新挂定时器 ; 只在所属线程调用
+            inline void check_timeout();
+
+            // 取消本线程上的超时定时器 , 关闭或迁移走时调用
+            inline void cancel_timeout_timer();
+
         private:
             socket_data::ptr socket_data_;
-            std::shared_ptr<service_thread> service_thread_;
+            std::atomic<service_thread *> service_thread_;
+            // 会话到过的线程 , 保证迁移前读到旧线程指针的发送方仍可安全使用它 , 只在迁移时追加
+            std::vector<std::shared_ptr<service_thread>> thread_holders_;
+            // 以下只在所属线程访问
+            unsigned int idle_timeout_ms_{0};
+            unsigned int read_timeout_ms_{0};
+            unsigned int write_timeout_ms_{0};
+            timer_id timeout_timer_{0};
         };
 
     }
@@ -5,14 +5,17 @@
 #include <cassert>
 #include <iostream>
 #include <string.h>
+#include <chrono>
+#include <algorithm>
 #include <spdnet/net/socket_data.h>
 #include <spdnet/net/service_thread.h>
 
 namespace spdnet {
     namespace net {
         tcp_session::tcp_session(sock_t fd, bool is_server_side, std::shared_ptr<service_thread> service_thread)
-                : service_thread_(service_thread) {
+                : service_thread_(service_thread.get()) {
             socket_data_ = std::make_shared<socket_data>(fd, is_server_side);
+            thread_holders_.push_back(std::move(service_thread));
         }
 
         std::shared_ptr<tcp_session>
@@ -32,21 +35,128 @@ namespace spdnet {
             });
         }
 
+        bool tcp_session::set_zerocopy_threshold(size_t threshold) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            if (current_thread()->backend() != io_backend::epoll)
+                return threshold == 0;
+            // 阈值只在io线程读取 , 投递过去修改
+            auto data = socket_data_;
+            if (threshold > 0 && socket_ops::socket_zerocopy(data->sock_fd()) != 0)
+                return false;
+            run_in_thread([data, threshold]() {
+                data->zerocopy_threshold_ = threshold;
+            });
+            return true;
+#else
+            return threshold == 0;
+#endif
+        }
+
         void tcp_session::send(const char *data, size_t len, socket_data::tcp_send_complete_callback &&callback) {
             if (len <= 0)
                 return;
-            auto &impl_ref = service_thread_->get_impl_ref();
+            auto &impl_ref = current_thread()->get_impl_ref();
             auto buffer = impl_ref.alloc_buffer(len);
             assert(buffer);
             buffer->write(data, len);
-            {
-                std::lock_guard<spdnet::base::spin_lock> lck(socket_data_->send_guard_);
-                socket_data_->send_packet_list_.emplace_back(socket_data::send_packet(buffer, std::move(callback)));
+            send_packet(socket_data::send_packet(buffer, std::move(callback)));
+        }
+
+        void tcp_session::send(std::string &&data, socket_data::tcp_send_complete_callback &&callback) {
+            if (data.empty())
+                return;
+            auto holder = std::make_shared<std::string>(std::move(data));
+            const char *ptr = holder->data();
+            size_t len = holder->size();
+            send_packet(socket_data::send_packet(std::move(holder), ptr, len, std::move(callback)));
+        }
+
+        void tcp_session::send(std::shared_ptr<const std::string> data,
+                               socket_data::tcp_send_complete_callback &&callback) {
+            if (data == nullptr || data->empty())
+                return;
+            const char *ptr = data->data();
+            size_t len = data->size();
+            send_packet(socket_data::send_packet(std::move(data), ptr, len, std::move(callback)));
+        }
+
+        void tcp_session::send_owned(const char *data, size_t len, std::shared_ptr<const void> owner,
+                                     socket_data::tcp_send_complete_callback &&callback) {
+            if (len <= 0)
+                return;
+            send_packet(socket_data::send_packet(std::move(owner), data, len, std::move(callback)));
+        }
+
+        void tcp_session::send(const send_fragment *fragments, size_t count,
+                               socket_data::tcp_send_complete_callback &&callback) {
+            size_t total_len = 0;
+            for (size_t i = 0; i < count; i++)
+                total_len += fragments[i].len;
+            if (total_len <= 0)
+                return;
+            auto &impl_ref = current_thread()->get_impl_ref();
+            auto buffer = impl_ref.alloc_buffer(total_len);
+            assert(buffer);
+            for (size_t i = 0; i < count; i++) {
+                if (fragments[i].len > 0)
+                    buffer->write(fragments[i].data, fragments[i].len);
             }
-            if (socket_data_->is_post_flush_) {
+            send_packet(socket_data::send_packet(buffer, std::move(callback)));
+        }
+
+        void tcp_session::send_owned(const send_fragment *fragments, size_t count, std::shared_ptr<const void> owner,
+                                     socket_data::tcp_send_complete_callback &&callback) {
+            size_t last = count;
+            for (size_t i = 0; i < count; i++) {
+                if (fragments[i].len > 0)
+                    last = i;
+            }
+            if (last == count)
                 return;
+            // 先串成一条链再整体入队 , 保证片段之间不会插入其它线程发送的数据
+            socket_data::send_packet_node *first = nullptr;
+            socket_data::send_packet_node *prev = nullptr;
+            for (size_t i = 0; i <= last; i++) {
+                if (fragments[i].len <= 0)
+                    continue;
+                socket_data::send_packet_node *node;
+                if (i < last)
+                    node = new socket_data::send_packet_node(owner, fragments[i].data, fragments[i].len, nullptr);
+                else
+                    node = new socket_data::send_packet_node(std::move(owner), fragments[i].data, fragments[i].len,
+                                                             std::move(callback));
+                if (prev != nullptr)
+                    prev->next_.store(node, std::memory_order_relaxed);
+                else
+                    first = node;
+                prev = node;
             }
-            socket_data_->is_post_flush_ = true;
+            if (SPDNET_PREDICT_FALSE(socket_data_->is_tracing_latency()))
+                prev->packet_.enqueue_time_ = std::chrono::steady_clock::now();
+            if (socket_data_->push_send_packets(first, prev))
+                post_flush();
+        }
+
+#if defined(SPDNET_PLATFORM_LINUX)
+
+        void tcp_session::send_file(int file_fd, off_t offset, size_t len,
+                                    socket_data::tcp_send_complete_callback &&callback) {
+            if (len <= 0 || file_fd < 0)
+                return;
+            send_packet(socket_data::send_packet(file_fd, offset, len, std::move(callback)));
+        }
+
+#endif
+
+        void tcp_session::send_packet(socket_data::send_packet &&packet) {
+            auto node = new socket_data::send_packet_node(std::move(packet));
+            if (SPDNET_PREDICT_FALSE(socket_data_->is_tracing_latency()))
+                node->packet_.enqueue_time_ = std::chrono::steady_clock::now();
+            if (socket_data_->push_send_packets(node, node))
+                post_flush();
+        }
+
+        void tcp_session::post_flush() {
             /*
              *   这里采用裸指针进行传递 ，主要是避免shared_ptr频繁的原子操作引起的性能上的损失 。
              *   裸指针生命周期的安全性由socket_data和channel的相互引用保证 。
@@ -54,17 +164,115 @@ namespace spdnet {
              *   channel的直正释放是被延迟到了epoll_wait和excutor之后 ， 所以channel和socket_data释放时，
              *   send函数投递的lamba肯定已经执行完了 , 因此lamba捕获的裸指针就不存在悬指针安全问题了。
              *   这种写法看起来很不舒服 ，但为了性能只能忍一忍了 ，哈哈
+             *   会话迁移时若有flush在途 , 它可能落到旧线程 , 由socket_data::migration_pin_保证它转投执行前socket_data不被释放 。
             **/
-            impl_ref.post_flush(socket_data_.get());
+            current_thread()->get_impl_ref().post_flush(socket_data_.get());
         }
 
         void tcp_session::post_shutdown() {
             auto this_ptr = shared_from_this();
-            service_thread_->get_executor()->post([this_ptr]() {
-                this_ptr->service_thread_->get_impl()->shutdown_socket(this_ptr->socket_data_);
+            run_in_thread([this_ptr]() {
+                this_ptr->current_thread()->get_impl()->shutdown_socket(this_ptr->socket_data_);
             });
         }
 
+        bool tcp_session::migrate(std::shared_ptr<service_thread> target) {
+#if defined(SPDNET_PLATFORM_LINUX)
+            auto thread = current_thread();
+            if (target == nullptr || target.get() == thread || !thread->get_impl_ref().support_migration()
+                || !target->get_impl_ref().support_migration())
+                return false;
+            auto this_ptr = shared_from_this();
+            // 不能在当前的回调里直接迁移 , 放到本轮循环末尾
+            run_in_thread([this_ptr, target]() {
+                this_ptr->current_thread()->migrate_tcp_session(this_ptr, target);
+            }, false);
+            return true;
+#else
+            (void) target;
+            return false;
+#endif
+        }
+
+        void tcp_session::set_idle_timeout(unsigned int ms) {
+            set_timeout(&tcp_session::idle_timeout_ms_, ms);
+        }
+
+        void tcp_session::set_read_timeout(unsigned int ms) {
+            set_timeout(&tcp_session::read_timeout_ms_, ms);
+        }
+
+        void tcp_session::set_write_timeout(unsigned int ms) {
+            set_timeout(&tcp_session::write_timeout_ms_, ms);
+        }
+
+        void tcp_session::set_timeout(unsigned int tcp_session::*timeout, unsigned int ms) {
+            auto this_ptr = shared_from_this();
+            run_in_thread([this_ptr, timeout, ms]() {
+                (*this_ptr).*timeout = ms;
+                this_ptr->cancel_timeout_timer();
+                this_ptr->check_timeout();
+            });
+        }
+
+        void tcp_session::check_timeout() {
+            timeout_timer_ = 0;
+            auto &data = *socket_data_;
+            if (data.has_closed_)
+                return;
+            auto now = std::chrono::steady_clock::now();
+            auto wait = std::chrono::steady_clock::duration::max();
+            bool expired = false;
+            auto check = [&now, &wait, &expired](unsigned int timeout_ms, std::chrono::steady_clock::time_point since) {
+                if (timeout_ms == 0)
+                    return;
+                auto left = since + std::chrono::milliseconds(timeout_ms) - now;
+                if (left <= std::chrono::steady_clock::duration::zero())
+                    expired = true;
+                else
+                    wait = (std::min)(wait, left);
+            };
+            check(idle_timeout_ms_, (std::max)(data.last_recv_time_, data.last_send_time_));
+            check(read_timeout_ms_, data.last_recv_time_);
+            if (!data.pending_packet_list_.empty())
+                check(write_timeout_ms_, data.last_send_time_);
+            else if (write_timeout_ms_ > 0)
+                wait = (std::min)(wait, std::chrono::steady_clock::duration(std::chrono::milliseconds(write_timeout_ms_)));
+
+            auto thread = current_thread();
+            if (expired) {
+                thread->get_impl()->close_socket(socket_data_);
+                return;
+            }
+            if (wait == std::chrono::steady_clock::duration::max())
+                return;
+            std::weak_ptr<tcp_session> weak_this = shared_from_this();
+            auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait).count() + 1;
+            timeout_timer_ = thread->run_after(static_cast<unsigned int>(wait_ms), [weak_this]() {
+                if (auto session = weak_this.lock())
+                    session->check_timeout();
+            });
+        }
+
+        void tcp_session::cancel_timeout_timer() {
+            if (timeout_timer_ == 0)
+                return;
+            current_thread()->cancel_timer(timeout_timer_);
+            timeout_timer_ = 0;
+        }
+
+        void tcp_session::run_in_thread(std::function<void()> &&task, bool is_try_immediate) {
+            auto thread = current_thread();
+            auto this_ptr = shared_from_this();
+            thread->get_executor()->post([this_ptr, thread, task]() mutable {
+                if (SPDNET_PREDICT_FALSE(this_ptr->current_thread() != thread)) {
+                    this_ptr->run_in_thread(std::move(task), false);
+                    return;
+                }
+                task();
+            }, is_try_immediate);
+        }
+
     }
 }
 #endif // SPDNET_NET_TCP_SESSION_IPP_
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef SPDNET_NET_THREAD_PLACEMENT_H_
+#define SPDNET_NET_THREAD_PLACEMENT_H_
+
+#include <vector>
+#include <spdnet/base/numa.h>
+
+namespace spdnet {
+    namespace net {
+        /*
+         * io线程的cpu绑定策略 。第i个线程绑定到cpu_sets[i % cpu_sets.size()] , cpu_sets为空时不绑定 。
+         * bind_memory为true且线程的cpu都在同一个numa节点上时 , 线程之后分配的内存(buffer缓存、会话表、
+         * 大页内存池等)都优先放在该节点上 。
+        **/
+        struct thread_placement {
+            std::vector<std::vector<int>> cpu_sets;
+            bool bind_memory{true};
+
+            bool empty() const {
+                return cpu_sets.empty();
+            }
+
+            const std::vector<int> &cpus_of(size_t thread_index) const {
+                return cpu_sets[thread_index % cpu_sets.size()];
+            }
+
+            // 线程依次轮流分到各个numa节点 , 每个线程可在所属节点的全部cpu上运行
+            static thread_placement spread_numa_nodes() {
+                thread_placement placement;
+                for (int node : spdnet::base::numa::online_nodes()) {
+                    std::vector<int> cpus = spdnet::base::numa::node_cpus(node);
+                    if (!cpus.empty())
+                        placement.cpu_sets.push_back(std::move(cpus));
+                }
+                return placement;
+            }
+
+            // 每个线程独占一个cpu , 先排满一个节点再到下一个节点
+            static thread_placement one_cpu_per_thread() {
+                thread_placement placement;
+                for (int node : spdnet::base::numa::online_nodes()) {
+                    for (int cpu : spdnet::base::numa::node_cpus(node))
+                        placement.cpu_sets.push_back(std::vector<int>{cpu});
+                }
+                return placement;
+            }
+        };
+    }
+}
+
+#endif // SPDNET_NET_THREAD_PLACEMENT_H_
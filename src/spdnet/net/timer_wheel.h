@@ -0,0 +1,318 @@
+#ifndef SPDNET_NET_TIMER_WHEEL_H_
+#define SPDNET_NET_TIMER_WHEEL_H_
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <spdnet/base/noncopyable.h>
+#include <spdnet/base/platform.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace spdnet {
+    namespace net {
+        using timer_id = uint64_t;
+        using timer_callback = std::function<void()>;
+
+        /*
+         * 分层时间轮 , 精度1ms 。第0层256个槽 , 每槽1ms ; 之上三层各64个槽 , 每槽是下一层一整圈 ,
+         * 共覆盖约18.6小时 , 更远的定时器先放在最高层 , 到期前再按实际时间重新放置 。
+         * 添加和取消都是O(1) , 每个tick只处理第0层的一个槽 , 进入上层槽的边界时把该槽的定时器下放一层 。
+         * 各层用位图记录非空的槽 , next_timeout据此算出下一次需要醒来的时间 , 作为io等待的超时 。
+         * 只能在所属的io线程里使用 。
+        **/
+        class timer_wheel : public spdnet::base::noncopyable {
+        public:
+            explicit timer_wheel(int64_t now_tick)
+                    : now_tick_(now_tick) {
+                for (auto &slot : near_)
+                    init_list(slot);
+                for (auto &level : far_) {
+                    for (auto &slot : level)
+                        init_list(slot);
+                }
+            }
+
+            ~timer_wheel() {
+                for (auto &item : timers_)
+                    delete item.second;
+            }
+
+            bool empty() const {
+                return timers_.empty();
+            }
+
+            size_t size() const {
+                return timers_.size();
+            }
+
+            // 在expire_tick到期 , interval大于0时之后每隔interval个tick重复 ; id由调用方分配且不能重复
+            void add(timer_id id, int64_t expire_tick, int64_t interval, timer_callback &&callback) {
+                auto node = new timer_node;
+                node->id_ = id;
+                node->expire_ = expire_tick > now_tick_ ? expire_tick : now_tick_ + 1;
+                node->interval_ = interval;
+                node->callback_ = std::move(callback);
+                timers_[id] = node;
+                place(node, now_tick_);
+            }
+
+            // 定时器不存在或已经到期时返回false ; 可以在回调里取消自己或其它定时器
+            bool cancel(timer_id id) {
+                auto iter = timers_.find(id);
+                if (iter == timers_.end())
+                    return false;
+                timer_node *node = iter->second;
+                timers_.erase(iter);
+                if (node == running_) {
+                    // 正在执行的回调里取消 , 回调返回后释放
+                    running_cancelled_ = true;
+                    return true;
+                }
+                unlink(node);
+                delete node;
+                return true;
+            }
+
+            // 执行到now_tick为止到期的定时器
+            void advance(int64_t now_tick) {
+                if (timers_.empty()) {
+                    if (now_tick > now_tick_)
+                        now_tick_ = now_tick;
+                    return;
+                }
+                while (now_tick_ < now_tick) {
+                    int64_t tick = now_tick_ + 1;
+                    cascade(tick);
+                    now_tick_ = tick;
+                    expire(tick);
+                    if (timers_.empty()) {
+                        now_tick_ = now_tick;
+                        break;
+                    }
+                }
+            }
+
+            // 距下一次需要处理定时器还有多少tick , 不超过max_ticks
+            int64_t next_timeout(int64_t now_tick, int64_t max_ticks) const {
+                if (timers_.empty())
+                    return max_ticks;
+                int64_t next = next_tick();
+                if (next <= now_tick)
+                    return 0;
+                return next - now_tick < max_ticks ? next - now_tick : max_ticks;
+            }
+
+        private:
+            static constexpr int near_bits = 8;
+            static constexpr int far_bits = 6;
+            static constexpr int far_levels = 3;
+            static constexpr size_t near_size = 1 << near_bits;
+            static constexpr size_t far_size = 1 << far_bits;
+
+            struct timer_node {
+                timer_node *prev_{nullptr};
+                timer_node *next_{nullptr};
+                timer_id id_{0};
+                int64_t expire_{0};
+                int64_t interval_{0};
+                // 所在的槽 , 用于槽变空时清除位图
+                int level_{-1};
+                size_t slot_{0};
+                timer_callback callback_;
+            };
+
+            static void init_list(timer_node &head) {
+                head.prev_ = &head;
+                head.next_ = &head;
+            }
+
+            static bool list_empty(const timer_node &head) {
+                return head.next_ == &head;
+            }
+
+            static int shift_of(int level) {
+                return near_bits + far_bits * level;
+            }
+
+            // level为-1表示第0层
+            timer_node &slot_head(int level, size_t slot) {
+                return level < 0 ? near_[slot] : far_[level][slot];
+            }
+
+            void link(timer_node *node, int level, size_t slot) {
+                timer_node &head = slot_head(level, slot);
+                node->level_ = level;
+                node->slot_ = slot;
+                node->prev_ = head.prev_;
+                node->next_ = &head;
+                head.prev_->next_ = node;
+                head.prev_ = node;
+                if (level < 0)
+                    near_bitmap_[slot / 64] |= uint64_t(1) << (slot % 64);
+                else
+                    far_bitmap_[level] |= uint64_t(1) << slot;
+            }
+
+            void unlink(timer_node *node) {
+                node->prev_->next_ = node->next_;
+                node->next_->prev_ = node->prev_;
+                timer_node &head = slot_head(node->level_, node->slot_);
+                if (list_empty(head)) {
+                    if (node->level_ < 0)
+                        near_bitmap_[node->slot_ / 64] &= ~(uint64_t(1) << (node->slot_ % 64));
+                    else
+                        far_bitmap_[node->level_] &= ~(uint64_t(1) << node->slot_);
+                }
+                node->prev_ = node->next_ = nullptr;
+            }
+
+            // 按到期时间和base(已处理到的tick)选择层和槽 , 要求expire_ >= base
+            void place(timer_node *node, int64_t base) {
+                int64_t expire = node->expire_;
+                if (expire - base < static_cast<int64_t>(near_size)) {
+                    link(node, -1, static_cast<size_t>(expire) & (near_size - 1));
+                    return;
+                }
+                for (int level = 0; level < far_levels; level++) {
+                    int shift = shift_of(level);
+                    if ((expire >> shift) - (base >> shift) < static_cast<int64_t>(far_size)) {
+                        link(node, level, static_cast<size_t>(expire >> shift) & (far_size - 1));
+                        return;
+                    }
+                }
+                // 超出范围 , 先放在最高层最远的槽 , 下放时重新计算
+                int shift = shift_of(far_levels - 1);
+                link(node, far_levels - 1, static_cast<size_t>((base >> shift) + far_size - 1) & (far_size - 1));
+            }
+
+            // tick是某个上层槽的起点时 , 把该槽的定时器按实际到期时间下放 , 先处理高层
+            void cascade(int64_t tick) {
+                if ((tick & static_cast<int64_t>(near_size - 1)) != 0)
+                    return;
+                int top = 0;
+                while (top + 1 < far_levels
+                       && ((tick >> shift_of(top)) & static_cast<int64_t>(far_size - 1)) == 0)
+                    top++;
+                for (int level = top; level >= 0; level--) {
+                    size_t slot = static_cast<size_t>(tick >> shift_of(level)) & (far_size - 1);
+                    timer_node &head = far_[level][slot];
+                    if (list_empty(head))
+                        continue;
+                    timer_node pending;
+                    take_list(head, pending);
+                    far_bitmap_[level] &= ~(uint64_t(1) << slot);
+                    while (!list_empty(pending)) {
+                        timer_node *node = pending.next_;
+                        node->prev_->next_ = node->next_;
+                        node->next_->prev_ = node->prev_;
+                        place(node, tick);
+                    }
+                }
+            }
+
+            void expire(int64_t tick) {
+                size_t slot = static_cast<size_t>(tick) & (near_size - 1);
+                timer_node &head = near_[slot];
+                if (list_empty(head))
+                    return;
+                // 先整体取出 , 回调里新加的定时器不会在本tick再次执行
+                timer_node pending;
+                take_list(head, pending);
+                near_bitmap_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+                while (!list_empty(pending)) {
+                    timer_node *node = pending.next_;
+                    node->prev_->next_ = node->next_;
+                    node->next_->prev_ = node->prev_;
+                    node->prev_ = node->next_ = nullptr;
+
+                    running_ = node;
+                    running_cancelled_ = false;
+                    if (node->interval_ <= 0)
+                        timers_.erase(node->id_);
+                    node->callback_();
+                    running_ = nullptr;
+
+                    if (node->interval_ > 0 && !running_cancelled_) {
+                        node->expire_ = tick + node->interval_;
+                        place(node, tick);
+                    } else {
+                        delete node;
+                    }
+                }
+            }
+
+            static void take_list(timer_node &head, timer_node &out) {
+                if (list_empty(head)) {
+                    init_list(out);
+                    return;
+                }
+                out.next_ = head.next_;
+                out.prev_ = head.prev_;
+                out.next_->prev_ = &out;
+                out.prev_->next_ = &out;
+                init_list(head);
+            }
+
+            static int lowest_bit(uint64_t value) {
+#if defined(_MSC_VER)
+                unsigned long index;
+                _BitScanForward64(&index, value);
+                return static_cast<int>(index);
+#else
+                return __builtin_ctzll(value);
+#endif
+            }
+
+            // 从bit开始循环查找第一个置位的位置 , 返回距离 , 没有时返回-1
+            static int next_set_bit(uint64_t bitmap, int bit) {
+                if (bitmap == 0)
+                    return -1;
+                uint64_t rotated = bit == 0 ? bitmap : (bitmap >> bit) | (bitmap << (64 - bit));
+                return lowest_bit(rotated);
+            }
+
+            // 下一个需要处理的tick : 第0层最近的到期时间 , 或者上层下一个非空槽的下放时间
+            int64_t next_tick() const {
+                int64_t best = INT64_MAX;
+                size_t start = static_cast<size_t>(now_tick_ + 1) & (near_size - 1);
+                for (size_t offset = 0; offset < near_size;) {
+                    size_t pos = (start + offset) & (near_size - 1);
+                    int bit = static_cast<int>(pos % 64);
+                    uint64_t bits = near_bitmap_[pos / 64] >> bit;
+                    if (bits != 0) {
+                        best = now_tick_ + 1 + static_cast<int64_t>(offset) + lowest_bit(bits);
+                        break;
+                    }
+                    offset += 64 - bit;
+                }
+                for (int level = 0; level < far_levels; level++) {
+                    int shift = shift_of(level);
+                    int64_t current = now_tick_ >> shift;
+                    int distance = next_set_bit(far_bitmap_[level],
+                                                static_cast<int>((current + 1) & static_cast<int64_t>(far_size - 1)));
+                    if (distance < 0)
+                        continue;
+                    int64_t cascade_tick = (current + 1 + distance) << shift;
+                    if (cascade_tick < best)
+                        best = cascade_tick;
+                }
+                return best;
+            }
+
+        private:
+            int64_t now_tick_;
+            timer_node near_[near_size];
+            timer_node far_[far_levels][far_size];
+            uint64_t near_bitmap_[near_size / 64]{0, 0, 0, 0};
+            uint64_t far_bitmap_[far_levels]{0, 0, 0};
+            std::unordered_map<timer_id, timer_node *> timers_;
+            timer_node *running_{nullptr};
+            bool running_cancelled_{false};
+        };
+    }
+}
+
+#endif  // SPDNET_NET_TIMER_WHEEL_H_